@@ -0,0 +1,129 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "BrokerClient.h"
+#include "ConnectionBroker.h"
+#include <QFile>
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+BrokerClient::BrokerClient(const QString &name)
+    : _path(ConnectionBroker::socketPath(name)), _fd(-1)
+{}
+
+BrokerClient::~BrokerClient()
+{
+#if defined(Q_OS_UNIX)
+    if (_fd >= 0)
+        ::close(_fd);
+#endif
+}
+
+bool BrokerClient::borrow(int nbWanted, QList<Loan> &loans, QString &error)
+{
+#if defined(Q_OS_UNIX)
+    QByteArray path = QFile::encodeName(_path);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    if (path.size() >= static_cast<int>(sizeof(addr.sun_path)))
+    {
+        error = QString("The path of the broker socket is too long: %1").arg(_path);
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.constData(), static_cast<size_t>(path.size()));
+
+    _fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_fd < 0 || ::connect(_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        error = QString("Error connecting to the broker %1: %2").arg(_path).arg(std::strerror(errno));
+        return false;
+    }
+
+    QList<int> fds;
+    QList<QByteArray> fields;
+    bool timedOut = false;
+    if (ConnectionBroker::sendMessage(_fd, QString("BORROW %1\n").arg(nbWanted).toLatin1()))
+    {
+        errno = 0;
+        QByteArray message = ConnectionBroker::receiveMessage(_fd, fds, sBorrowTimeout);
+        timedOut = message.isEmpty() && errno == ETIMEDOUT;
+        fields   = message.trimmed().split(' ');
+    }
+    if (fields.first() != "LEND" || fields.size() != fds.size() + 2)
+    {
+        for (int fd : fds)
+            ::close(fd);
+        ::close(_fd); // a late LEND fails on the broker side: it takes its loans back
+        _fd = -1;
+        if (timedOut)
+            error = QString("No answer from the broker %1 after %2 ms").arg(_path).arg(sBorrowTimeout);
+        else
+            error = QString("Wrong answer from the broker %1").arg(_path);
+        return false;
+    }
+
+    for (int i = 0; i < fds.size(); ++i)
+    {
+        QList<QByteArray> loan = fields.at(i + 2).split(':');
+        if (loan.size() == 3)
+            loans << Loan{loan.at(0).toInt(), QString::fromUtf8(loan.at(1)), loan.at(2).toUShort(), fds.at(i)};
+        else
+            ::close(fds.at(i));
+    }
+    return true;
+#else
+    Q_UNUSED(nbWanted)
+    Q_UNUSED(loans)
+    error = QString("The connection broker is only available on Unix");
+    return false;
+#endif
+}
+
+void BrokerClient::giveBack(const QList<QPair<int, int>> &loans)
+{
+#if defined(Q_OS_UNIX)
+    if (_fd < 0)
+        return;
+    QList<int> fds;
+    for (const QPair<int, int> &loan : loans)
+        fds << loan.second;
+    for (int i = 0; i < fds.size(); i += ConnectionBroker::sMaxFdsPerMessage)
+    {
+        QList<int> sockets = fds.mid(i, ConnectionBroker::sMaxFdsPerMessage);
+        QByteArray ids;
+        for (int j = i; j < i + sockets.size(); ++j)
+            ids += ' ' + QByteArray::number(loans.at(j).first);
+        ConnectionBroker::sendMessage(_fd, "RETURN" + ids + '\n', sockets);
+    }
+    for (int fd : fds)
+        ::close(fd); // the broker has its own
+    ::close(_fd);
+    _fd = -1;
+#else
+    Q_UNUSED(loans)
+#endif
+}
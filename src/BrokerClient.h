@@ -0,0 +1,66 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef BROKERCLIENT_H
+#define BROKERCLIENT_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+
+/*!
+ * \brief borrows authenticated connections from a ConnectionBroker (--use-broker)
+ * the exchanges are blocking: they're small and only done at the start and at the end of a check
+ * (the LEND is awaited sBorrowTimeout ms at most: a stuck broker doesn't hang the check)
+ * the control socket stays open during the check: the broker takes back the loans when it is closed
+ */
+class BrokerClient
+{
+public:
+    struct Loan {
+        int     id;
+        QString host;
+        ushort  port;
+        int     socketDescriptor; //!< connected and authenticated (plain stream, even for an SSL server)
+    };
+
+    static const int sBorrowTimeout = 5000; //!< ms to wait for the LEND of the broker
+
+    explicit BrokerClient(const QString &name);
+    ~BrokerClient();
+
+    BrokerClient(const BrokerClient &other) = delete;
+    BrokerClient & operator=(const BrokerClient &other) = delete;
+
+    bool borrow(int nbWanted, QList<Loan> &loans, QString &error);
+    //! give back the sockets (loanId, socketDescriptor) and close the control socket
+    void giveBack(const QList<QPair<int, int>> &loans);
+
+    inline const QString &path() const;
+
+private:
+    const QString _path;
+    int           _fd; //!< control socket
+};
+
+const QString &BrokerClient::path() const { return _path; }
+
+#endif // BROKERCLIENT_H
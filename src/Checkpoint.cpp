@@ -0,0 +1,129 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "Checkpoint.h"
+#include <QCryptographicHash>
+#include <QSaveFile>
+
+Checkpoint::Checkpoint(const QString &filePath):
+    _file(filePath), _stream(), _indexes(), _checked(), _missing(), _nbResumed(0)
+{}
+
+bool Checkpoint::open(const QVector<NzbFile> &files, QString &error)
+{
+    quint32 index = 0;
+    for (const NzbFile &nzbFile : files)
+    {
+        for (const NzbSegment &segment : nzbFile.segments)
+            _indexes.insert(segment.msgId, index++);
+    }
+    _checked.resize(static_cast<int>(index));
+    _missing.resize(static_cast<int>(index));
+
+    QByteArray fingerprint = Checkpoint::fingerprint(files);
+    if (_file.exists())
+        _load(fingerprint);
+
+    // compact: the appends of the previous run(s) are now in the bitmaps
+    QSaveFile saveFile(_file.fileName());
+    if (saveFile.open(QIODevice::WriteOnly))
+    {
+        QDataStream stream(&saveFile);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << sMagic << sVersion << fingerprint << index << _checked << _missing;
+    }
+    if (!saveFile.commit() || !_file.open(QIODevice::WriteOnly|QIODevice::Append))
+    {
+        error = QString("Error writing the checkpoint %1: %2").arg(_file.fileName()).arg(
+                    saveFile.error() != QFileDevice::NoError ? saveFile.errorString() : _file.errorString());
+        return false;
+    }
+
+    _stream.setDevice(&_file);
+    _stream.setVersion(QDataStream::Qt_5_0);
+    return true;
+}
+
+void Checkpoint::add(const QString &article, bool missing)
+{
+    auto it = _indexes.constFind(article);
+    if (it != _indexes.cend())
+        _stream << (missing ? it.value() | sMissingFlag : it.value());
+}
+
+void Checkpoint::flush()
+{
+    if (_file.isOpen())
+        _file.flush();
+}
+
+void Checkpoint::remove()
+{
+    _stream.setDevice(nullptr);
+    _file.remove();
+}
+
+void Checkpoint::_load(const QByteArray &fingerprint)
+{
+    QFile file(_file.fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32    magic = 0, nbArticles = 0;
+    quint16    version = 0;
+    QByteArray previousFingerprint;
+    QBitArray  checked, missing;
+    stream >> magic >> version >> previousFingerprint >> nbArticles >> checked >> missing;
+    if (stream.status() != QDataStream::Ok || magic != sMagic || version != sVersion
+            || previousFingerprint != fingerprint || nbArticles != static_cast<quint32>(_checked.size())
+            || checked.size() != _checked.size() || missing.size() != _missing.size())
+        return; // another nzb (or not a checkpoint): start from scratch
+
+    _checked = checked;
+    _missing = missing;
+    // the last append may be truncated if the process was killed while writing it
+    while (!stream.atEnd())
+    {
+        quint32 record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok)
+            break;
+        int index = static_cast<int>(record & ~sMissingFlag);
+        if (index >= _checked.size())
+            break;
+        _checked.setBit(index);
+        _missing.setBit(index, record & sMissingFlag);
+    }
+    _nbResumed = _checked.count(true);
+}
+
+QByteArray Checkpoint::fingerprint(const QVector<NzbFile> &files)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const NzbFile &nzbFile : files)
+    {
+        for (const NzbSegment &segment : nzbFile.segments)
+            hash.addData(segment.msgId.toUtf8());
+    }
+    return hash.result();
+}
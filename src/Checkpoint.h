@@ -0,0 +1,91 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QFile>
+#include <QDataStream>
+#include "NzbParser.h"
+
+/*!
+ * \brief state of a long check saved on disk so a killed run can be resumed (--checkpoint)
+ * format (QDataStream): header (sMagic, sVersion, fingerprint of the nzb, nbArticles),
+ * the bitmaps of the Articles checked and missing when the file was (re)written,
+ * then one quint32 appended per answer: index of the Article in the nzb (sMissingFlag if missing)
+ * the appends only go in the buffer of the file, NzbCheck flushes it periodically
+ */
+class Checkpoint
+{
+public:
+    static const quint32 sMagic       = 0x4e5a424b; //!< "NZBK"
+    static const quint16 sVersion     = 1;
+    static const quint32 sMissingFlag = 0x80000000;
+
+    explicit Checkpoint(const QString &filePath);
+    ~Checkpoint() = default;
+
+    Checkpoint(const Checkpoint &other) = delete;
+    Checkpoint & operator=(const Checkpoint &other) = delete;
+
+    //! index the Articles of the nzb, load the state of the previous run if it was on the same nzb
+    //! then rewrite it compacted (bitmaps only) and open it for the appends
+    bool open(const QVector<NzbFile> &files, QString &error);
+
+    inline bool isChecked(const QString &article, bool &missing) const;
+    inline int  nbResumed() const;
+
+    void add(const QString &article, bool missing);
+    void flush();
+    void remove(); //!< the check is complete
+
+    inline QString filePath() const;
+
+    //! the Articles in the order of the nzb: the same post gives the same fingerprint whatever its path
+    static QByteArray fingerprint(const QVector<NzbFile> &files);
+
+private:
+    QFile                   _file;
+    QDataStream             _stream;
+    QHash<QString, quint32> _indexes; //!< of the Articles in the nzb
+    QBitArray               _checked;
+    QBitArray               _missing;
+    int                     _nbResumed; //!< Articles checked by the previous run(s)
+
+    void _load(const QByteArray &fingerprint);
+};
+
+bool Checkpoint::isChecked(const QString &article, bool &missing) const
+{
+    auto it = _indexes.constFind(article);
+    if (it == _indexes.cend() || !_checked.testBit(static_cast<int>(it.value())))
+        return false;
+    missing = _missing.testBit(static_cast<int>(it.value()));
+    return true;
+}
+int Checkpoint::nbResumed() const { return _nbResumed; }
+QString Checkpoint::filePath() const { return _file.fileName(); }
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,441 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ConnectionBroker.h"
+#include "NzbCheck.h"
+#include "NntpCon.h"
+#include <QSocketNotifier>
+#include <QTcpSocket>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <algorithm>
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+ConnectionBroker::ConnectionBroker(NzbCheck *nzbCheck)
+    : QObject(),
+      _nzbCheck(nzbCheck), _path(), _listenFd(-1), _listenNotifier(nullptr),
+      _clients(), _loans(), _lastLoanId(0)
+{}
+
+ConnectionBroker::~ConnectionBroker()
+{
+#if defined(Q_OS_UNIX)
+    for (auto it = _clients.cbegin(); it != _clients.cend(); ++it)
+    {
+        delete it.value().notifier;
+        for (int fd : it.value().fds)
+            ::close(fd);
+        ::close(it.key());
+    }
+    if (_listenNotifier)
+        delete _listenNotifier;
+    if (_listenFd >= 0)
+    {
+        ::close(_listenFd);
+        QFile::remove(_path);
+    }
+#endif
+}
+
+QString ConnectionBroker::socketPath(const QString &name)
+{
+    if (name.contains('/'))
+        return name;
+    return QString("%1/nzbcheck-%2.sock").arg(QDir::tempPath()).arg(name);
+}
+
+bool ConnectionBroker::listen(const QString &name, QString &error)
+{
+#if defined(Q_OS_UNIX)
+    _path = socketPath(name);
+    QByteArray path = QFile::encodeName(_path);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    if (path.size() >= static_cast<int>(sizeof(addr.sun_path)))
+    {
+        error = tr("The path of the broker socket is too long: %1").arg(_path);
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.constData(), static_cast<size_t>(path.size()));
+
+    _listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.constData()); // left by a broker that crashed
+    if (_listenFd < 0
+            || ::bind(_listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::chmod(path.constData(), S_IRUSR | S_IWUSR) != 0 // only our user borrows authenticated connections
+            || ::listen(_listenFd, 16) != 0)
+    {
+        error = tr("Error listening on %1: %2").arg(_path).arg(std::strerror(errno));
+        return false;
+    }
+
+    _listenNotifier = new QSocketNotifier(_listenFd, QSocketNotifier::Read);
+    connect(_listenNotifier, SIGNAL(activated(int)), this, SLOT(onNewClient()));
+    return true;
+#else
+    Q_UNUSED(name)
+    error = tr("The connection broker is only available on Unix");
+    return false;
+#endif
+}
+
+void ConnectionBroker::onNewClient()
+{
+#if defined(Q_OS_UNIX)
+    int clientFd = ::accept(_listenFd, nullptr, nullptr);
+    if (clientFd < 0)
+        return;
+    int flags = ::fcntl(clientFd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(clientFd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        ::close(clientFd); // it could block the broker
+        return;
+    }
+    QSocketNotifier *notifier = new QSocketNotifier(clientFd, QSocketNotifier::Read);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(onClientMessage(int)));
+    _clients.insert(clientFd, Client{notifier, QByteArray(), QList<int>()});
+#endif
+}
+
+void ConnectionBroker::onClientMessage(int clientFd)
+{
+#if defined(Q_OS_UNIX)
+    if (!_clients.contains(clientFd))
+        return;
+
+    Client &client = _clients[clientFd];
+    int nb = receive(clientFd, client.buffer, client.fds, false);
+    if (nb < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return; // spurious wake up
+    if (nb <= 0)
+    {
+        _clientGone(clientFd);
+        return;
+    }
+
+    int end;
+    while ((end = client.buffer.indexOf('\n')) >= 0)
+    {
+        QList<QByteArray> fields = client.buffer.left(end).trimmed().split(' ');
+        client.buffer.remove(0, end + 1);
+        if (fields.first() == "BORROW" && fields.size() == 2)
+        {
+            if (!_lend(clientFd, fields.at(1).toInt()))
+                return; // client dropped
+        }
+        else if (fields.first() == "RETURN")
+        {
+            // the sockets of a RETURN come with its first bytes, so they're the first ones not taken
+            QList<int> fds = client.fds.mid(0, fields.size() - 1);
+            client.fds     = client.fds.mid(fds.size());
+            _takeBack(clientFd, fields.mid(1), fds);
+        }
+        else
+        {
+            _clientGone(clientFd);
+            return;
+        }
+    }
+    if (client.buffer.size() > sMessageSize)
+        _clientGone(clientFd); // not our protocol
+#else
+    Q_UNUSED(clientFd)
+#endif
+}
+
+bool ConnectionBroker::_lend(int clientFd, int nbWanted)
+{
+#if defined(Q_OS_UNIX)
+    nbWanted = std::min(nbWanted, static_cast<int>(sMaxFdsPerMessage));
+    QByteArray loans;
+    QList<int> fds;
+    for (NntpCon *con : _nzbCheck->idleConnections())
+    {
+        if (fds.size() >= nbWanted)
+            break;
+
+        const NntpServerParams &srvParams = con->srvParams();
+        Loan loan{&srvParams, con->id(), nullptr, clientFd};
+        int fd = -1;
+        if (srvParams.useSSL)
+        {
+            int pair[2];
+            if (!_socketPair(pair))
+                continue;
+            QTcpSocket *peer = new QTcpSocket();
+            if (!peer->setSocketDescriptor(pair[0]))
+            {
+                delete peer;
+                ::close(pair[0]);
+                ::close(pair[1]);
+                continue;
+            }
+            con->proxy(peer);
+            loan.proxied = con;
+            fd = pair[1];
+        }
+        else
+        {
+            fd = con->detachSocket();
+            if (fd < 0)
+                continue;
+            _nzbCheck->removeConnection(con);
+        }
+
+        _loans.insert(++_lastLoanId, loan);
+        loans += QString(" %1:%2:%3").arg(_lastLoanId).arg(srvParams.host).arg(srvParams.port).toUtf8();
+        fds << fd;
+    }
+
+    // non-blocking: a full socket (the borrower doesn't read) or a partial LEND drops it, its loans are reopened
+    bool sent = sendMessage(clientFd, QByteArray("LEND ") + QByteArray::number(fds.size()) + loans + '\n', fds);
+    for (int fd : fds)
+        ::close(fd); // the borrower has its own now
+    if (!sent)
+    {
+        if (_nzbCheck->debugMode())
+            _nzbCheck->log(tr("A borrower doesn't read its LEND: dropped"));
+        _clientGone(clientFd);
+        return false;
+    }
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("%1 connection(s) lent (%2 asked)").arg(fds.size()).arg(nbWanted));
+    return true;
+#else
+    Q_UNUSED(clientFd)
+    Q_UNUSED(nbWanted)
+    return false;
+#endif
+}
+
+void ConnectionBroker::_takeBack(int clientFd, const QList<QByteArray> &loanIds, const QList<int> &fds)
+{
+#if defined(Q_OS_UNIX)
+    for (int i = 0; i < fds.size(); ++i)
+    {
+        int loanId = i < loanIds.size() ? loanIds.at(i).toInt() : 0;
+        if (!_loans.contains(loanId) || _loans.value(loanId).clientFd != clientFd)
+        {
+            ::close(fds.at(i));
+            continue;
+        }
+
+        Loan loan = _loans.take(loanId);
+        if (loan.proxied)
+        {
+            // closing the borrower's end ends the forwarding (once the borrower has closed its own)
+            loan.proxied->proxyReturned();
+            ::close(fds.at(i));
+        }
+        else if (!loan.srvParams->useSSL)
+            _nzbCheck->adoptConnection(*loan.srvParams, loan.conId, fds.at(i));
+        else
+            ::close(fds.at(i)); // the SSL connection has been lost meanwhile (reopened by the pool)
+    }
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("%1 connection(s) given back").arg(fds.size()));
+#else
+    Q_UNUSED(clientFd)
+    Q_UNUSED(loanIds)
+    Q_UNUSED(fds)
+#endif
+}
+
+void ConnectionBroker::_clientGone(int clientFd)
+{
+#if defined(Q_OS_UNIX)
+    Client client = _clients.take(clientFd);
+    delete client.notifier;
+    for (int fd : client.fds)
+        ::close(fd);
+    ::close(clientFd);
+
+    // the plain sockets not given back are lost: reopen them (the SSL ones see their borrower closed)
+    for (auto it = _loans.begin(); it != _loans.end(); )
+    {
+        if (it.value().clientFd != clientFd)
+            ++it;
+        else
+        {
+            if (!it.value().srvParams->useSSL)
+                _nzbCheck->reopenConnection(*it.value().srvParams, it.value().conId);
+            it = _loans.erase(it);
+        }
+    }
+#else
+    Q_UNUSED(clientFd)
+#endif
+}
+
+bool ConnectionBroker::_socketPair(int fds[2])
+{
+#if defined(Q_OS_UNIX)
+    // nothing listening on the network: only the borrower (that got its end with SCM_RIGHTS) can use it
+    // QTcpSocket takes a Unix stream socket like the TCP one of a plain connection
+    return ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0;
+#else
+    Q_UNUSED(fds)
+    return false;
+#endif
+}
+
+bool ConnectionBroker::sendMessage(int fd, const QByteArray &message, const QList<int> &fds)
+{
+#if defined(Q_OS_UNIX)
+    union {
+        struct cmsghdr header;
+        char           data[CMSG_SPACE(sMaxFdsPerMessage * sizeof(int))];
+    } control;
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(message.constData());
+    iov.iov_len  = static_cast<size_t>(message.size());
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+    if (!fds.isEmpty())
+    {
+        std::memset(&control, 0, sizeof(control));
+        msg.msg_control    = control.data;
+        msg.msg_controllen = CMSG_SPACE(static_cast<size_t>(fds.size()) * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(static_cast<size_t>(fds.size()) * sizeof(int));
+        int *data = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+        for (int i = 0; i < fds.size(); ++i)
+            data[i] = fds.at(i);
+    }
+
+#if defined(MSG_NOSIGNAL)
+    const int flags = MSG_NOSIGNAL; // no SIGPIPE if the other side is gone
+#else
+    const int flags = 0;
+#endif
+    ssize_t nbSent;
+    do
+        nbSent = ::sendmsg(fd, &msg, flags);
+    while (nbSent < 0 && errno == EINTR);
+    while (nbSent >= 0 && nbSent < message.size())
+    {
+        // the sockets went with the first bytes
+        ssize_t nb = ::send(fd, message.constData() + nbSent, static_cast<size_t>(message.size() - nbSent), flags);
+        if (nb < 0 && errno != EINTR)
+            return false; // EAGAIN on a non-blocking socket too: the caller drops it
+        if (nb > 0)
+            nbSent += nb;
+    }
+    return nbSent == message.size();
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(message)
+    Q_UNUSED(fds)
+    return false;
+#endif
+}
+
+QByteArray ConnectionBroker::receiveMessage(int fd, QList<int> &fds, int timeout)
+{
+    QByteArray message;
+#if defined(Q_OS_UNIX)
+    QElapsedTimer clock;
+    clock.start();
+    while (!message.endsWith('\n'))
+    {
+        if (timeout >= 0)
+        {
+            struct pollfd pfd{fd, POLLIN, 0};
+            int remaining = std::max(0, timeout - static_cast<int>(clock.elapsed()));
+            int nbReady   = ::poll(&pfd, 1, remaining);
+            if (nbReady < 0 && errno == EINTR)
+                continue;
+            if (nbReady == 0)
+                errno = ETIMEDOUT;
+            if (nbReady <= 0)
+                return QByteArray();
+        }
+        int nb = receive(fd, message, fds, true);
+        if (nb < 0 && errno == EINTR)
+            continue;
+        if (nb <= 0)
+            return QByteArray(); // disconnected
+    }
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(fds)
+    Q_UNUSED(timeout)
+#endif
+    return message;
+}
+
+int ConnectionBroker::receive(int fd, QByteArray &buffer, QList<int> &fds, bool wait)
+{
+#if defined(Q_OS_UNIX)
+    char bytes[sMessageSize];
+    union {
+        struct cmsghdr header;
+        char           data[CMSG_SPACE(sMaxFdsPerMessage * sizeof(int))];
+    } control;
+    struct iovec iov;
+    iov.iov_base = bytes;
+    iov.iov_len  = sizeof(bytes);
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.data;
+    msg.msg_controllen = sizeof(control.data);
+
+    ssize_t nb = ::recvmsg(fd, &msg, wait ? 0 : MSG_DONTWAIT);
+    if (nb <= 0)
+        return static_cast<int>(nb);
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            const int *data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            size_t nbFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < nbFds; ++i)
+                fds << data[i];
+        }
+    }
+    buffer.append(bytes, static_cast<int>(nb));
+    return static_cast<int>(nb);
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(buffer)
+    Q_UNUSED(fds)
+    Q_UNUSED(wait)
+    return -1;
+#endif
+}
@@ -0,0 +1,108 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef CONNECTIONBROKER_H
+#define CONNECTIONBROKER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QList>
+class NzbCheck;
+class NntpCon;
+class QSocketNotifier;
+struct NntpServerParams;
+
+/*!
+ * \brief lends the authenticated connections of a NzbCheck pool to short-lived nzbcheck (--broker / --use-broker)
+ * the borrowers connect on a Unix socket, the connections are given with SCM_RIGHTS:
+ *  - plain ones: the TCP socket itself, the borrower gives it back at the end (or QUIT it if it's not clean)
+ *  - SSL ones: the TLS state can't be given so the borrower gets one end of a Unix socketpair
+ *    and the broker forwards the decrypted stream (cf NntpCon::proxy)
+ * line protocol (one message per sendmsg, the sockets attached in the same order):
+ *   borrower -> broker: BORROW <nb>
+ *   broker -> borrower: LEND <nb> <loanId>:<host>:<port>...   + nb sockets
+ *   borrower -> broker: RETURN <loanId>...                     + the sockets given back
+ * the loans not given back when the borrower disconnects are closed and reopened
+ * the broker never blocks on a borrower: what it reads is buffered per client until a whole line is there
+ * and the control sockets are non-blocking: a borrower that doesn't read its LEND is dropped (its loans reopened)
+ * Unix only
+ */
+class ConnectionBroker : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Client {
+        QSocketNotifier *notifier;
+        QByteArray       buffer; //!< bytes received, not a whole line yet
+        QList<int>       fds;    //!< sockets received, not taken by a RETURN yet
+    };
+
+    struct Loan {
+        const NntpServerParams *srvParams;
+        int                     conId;
+        QPointer<NntpCon>       proxied;  //!< SSL connection forwarding to the borrower (nullptr for a plain one)
+        int                     clientFd; //!< control socket of the borrower
+    };
+
+    NzbCheck *const               _nzbCheck;
+    QString                       _path;
+    int                           _listenFd;
+    QSocketNotifier              *_listenNotifier;
+    QHash<int, Client>            _clients; //!< per control socket
+    QHash<int, Loan>              _loans;   //!< per loanId
+    int                           _lastLoanId;
+
+public:
+    static const int sMaxFdsPerMessage = 250; //!< below the SCM_RIGHTS limit of Linux (253)
+
+    explicit ConnectionBroker(NzbCheck *nzbCheck);
+    ~ConnectionBroker();
+
+    ConnectionBroker(const ConnectionBroker &other) = delete;
+    ConnectionBroker & operator=(const ConnectionBroker &other) = delete;
+
+    bool listen(const QString &name, QString &error);
+
+    //! name of the broker to the path of its Unix socket (in the temp folder if it is not a path)
+    static QString socketPath(const QString &name);
+    static bool sendMessage(int fd, const QByteArray &message, const QList<int> &fds = QList<int>());
+    //! one line with the sockets attached, waiting for it at most timeout ms (-1: no limit)
+    //! empty on disconnection or timeout (errno ETIMEDOUT)
+    static QByteArray receiveMessage(int fd, QList<int> &fds, int timeout = -1);
+    //! one recvmsg appended to buffer and fds: number of bytes read (0 on disconnection, -1 on error or nothing to read)
+    static int receive(int fd, QByteArray &buffer, QList<int> &fds, bool wait);
+
+private slots:
+    void onNewClient();
+    void onClientMessage(int clientFd);
+
+private:
+    bool _lend(int clientFd, int nbWanted); //!< false if the client has been dropped
+    void _takeBack(int clientFd, const QList<QByteArray> &loanIds, const QList<int> &fds);
+    void _clientGone(int clientFd);
+    static bool _socketPair(int fds[2]);
+
+    static const int sMessageSize = 16384; //!< also the longest line we buffer for a borrower
+};
+
+#endif // CONNECTIONBROKER_H
@@ -0,0 +1,128 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ConnectionLedger.h"
+#include "NntpServerParams.h"
+#include <QCryptographicHash>
+#include <QLockFile>
+#include <QDir>
+#include <QFile>
+#include <QCoreApplication>
+#include <algorithm>
+
+ConnectionLedger::ConnectionLedger(const NntpServerParams &srvParams)
+    : _dirPath(QString("%1/nzbcheck-ledger/%2").arg(QDir::tempPath()).arg(
+                   // the user is not written in clear in the temp folder
+                   QString(QCryptographicHash::hash(
+                               QString("%1:%2:%3").arg(srvParams.host).arg(srvParams.port).arg(
+                                   srvParams.user.c_str()).toUtf8(),
+                               QCryptographicHash::Sha1).toHex().left(16)))),
+      _process(nullptr), _slots()
+{
+    _slots.fill(nullptr, _sharedLimit(srvParams.nbCons));
+}
+
+ConnectionLedger::~ConnectionLedger()
+{
+    qDeleteAll(_slots); // unlock
+    if (_process)
+        delete _process;
+}
+
+int ConnectionLedger::_sharedLimit(int nbCons)
+{
+    if (!QDir().mkpath(_dirPath))
+        return nbCons;
+
+    // one process at a time: the check of the others and the limit go together
+    QLockFile guard(QString("%1/limit.lock").arg(_dirPath));
+    guard.setStaleLockTime(0);
+    if (!guard.lock())
+        return nbCons;
+
+    bool first = true;
+    for (const QString &fileName : QDir(_dirPath).entryList({"process-*.lock"}, QDir::Files))
+    {
+        QLockFile other(QString("%1/%2").arg(_dirPath).arg(fileName));
+        other.setStaleLockTime(0);
+        if (other.tryLock(0))
+            other.unlock(); // its process is dead
+        else
+            first = false;
+    }
+    _process = new QLockFile(QString("%1/process-%2.lock").arg(_dirPath).arg(QCoreApplication::applicationPid()));
+    _process->setStaleLockTime(0);
+    _process->tryLock(0);
+
+    QFile limitFile(QString("%1/limit").arg(_dirPath));
+    int limit = 0;
+    if (!first && limitFile.open(QIODevice::ReadOnly))
+    {
+        limit = limitFile.readAll().trimmed().toInt();
+        limitFile.close();
+    }
+    if (limit <= 0)
+    {
+        limit = nbCons;
+        if (limitFile.open(QIODevice::WriteOnly|QIODevice::Truncate))
+            limitFile.write(QByteArray::number(limit));
+    }
+    return limit;
+}
+
+QList<int> ConnectionLedger::lease(int nbWanted)
+{
+    QList<int> leased;
+    if (nbWanted <= 0 || !QDir().mkpath(_dirPath))
+        return leased;
+
+    for (int slot = 0; slot < _slots.size() && leased.size() < nbWanted; ++slot)
+    {
+        if (_slots.at(slot))
+            continue; // already ours
+
+        QLockFile *lockFile = new QLockFile(QString("%1/slot-%2.lock").arg(_dirPath).arg(slot));
+        lockFile->setStaleLockTime(0); // only stale when its process is dead, whatever its age
+        if (lockFile->tryLock(0))
+        {
+            _slots[slot] = lockFile;
+            leased << slot;
+        }
+        else
+            delete lockFile;
+    }
+    return leased;
+}
+
+void ConnectionLedger::release(int slot)
+{
+    if (slot < 0 || slot >= _slots.size())
+        return;
+    delete _slots.at(slot); // unlock
+    _slots[slot] = nullptr;
+}
+
+int ConnectionLedger::nbLeased() const
+{
+    return static_cast<int>(std::count_if(_slots.cbegin(), _slots.cend(), [](const QLockFile *lockFile) {
+        return lockFile != nullptr;
+    }));
+}
@@ -0,0 +1,67 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef CONNECTIONLEDGER_H
+#define CONNECTIONLEDGER_H
+
+#include <QString>
+#include <QVector>
+#include <QList>
+struct NntpServerParams;
+class QLockFile;
+
+/*!
+ * \brief connection slots of one account (host, port, user) shared by the nzbcheck processes of the host (--shared-cons)
+ * the account has nbCons slots, each one is a lock file in the temp folder:
+ * a process leases free slots before opening connections and releases them as soon as they're closed
+ * the lock files of a process that crashed are stale (dead pid) and taken back by the next lease
+ * the number of slots is written in the folder by the first process of the account,
+ * the next ones follow it as long as a process of the account is running (whatever their nbCons)
+ */
+class ConnectionLedger
+{
+private:
+    const QString       _dirPath;
+    QLockFile          *_process; //!< our presence in the account (keeps its limit)
+    QVector<QLockFile*> _slots;   //!< nullptr for the slots we don't hold
+
+    int _sharedLimit(int nbCons); //!< register our process, return the limit of the account
+
+public:
+    explicit ConnectionLedger(const NntpServerParams &srvParams);
+    ~ConnectionLedger(); //!< release all our slots
+
+    ConnectionLedger(const ConnectionLedger &other) = delete;
+    ConnectionLedger & operator=(const ConnectionLedger &other) = delete;
+
+    //! lease up to nbWanted free slots (none if we can't create the folder), return their index
+    QList<int> lease(int nbWanted);
+    void release(int slot);
+
+    inline int nbSlots() const;
+    int nbLeased() const;
+    inline const QString &dirPath() const;
+};
+
+int ConnectionLedger::nbSlots() const { return _slots.size(); }
+const QString &ConnectionLedger::dirPath() const { return _dirPath; }
+
+#endif // CONNECTIONLEDGER_H
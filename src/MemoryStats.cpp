@@ -0,0 +1,89 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "MemoryStats.h"
+#include <cstdlib>
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+std::atomic<bool>   MemoryStats::sEnabled(false);
+bool                MemoryStats::sHooked = false;
+std::atomic<qint64> MemoryStats::sNbAllocations[MemoryStats::sNbStages];
+std::atomic<qint64> MemoryStats::sNbBytes[MemoryStats::sNbStages];
+std::atomic<qint64> MemoryStats::sHeapGrowth[MemoryStats::sNbStages];
+thread_local MemoryStats::Stage MemoryStats::sCurrentStage = MemoryStats::Stage::OTHER;
+thread_local qint64 MemoryStats::sNestedGrowth = 0;
+
+qint64 MemoryStats::nbAllocations(Stage stage)
+{
+    return sNbAllocations[static_cast<int>(stage)].load(std::memory_order_relaxed);
+}
+
+qint64 MemoryStats::nbBytes(Stage stage)
+{
+    return sNbBytes[static_cast<int>(stage)].load(std::memory_order_relaxed);
+}
+
+qint64 MemoryStats::heapGrowth(Stage stage)
+{
+    return sHeapGrowth[static_cast<int>(stage)].load(std::memory_order_relaxed);
+}
+
+const char *MemoryStats::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::PARSE:      return "parse";
+    case Stage::QUEUE:      return "queue";
+    case Stage::CONNECTION: return "connections";
+    case Stage::OUTPUT:     return "output";
+    default:                return "other";
+    }
+}
+
+qint64 MemoryStats::peakRssKB()
+{
+#if defined(Q_OS_MACOS)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024; // bytes on MacOS
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryStats::heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<qint64>(info.uordblks + info.hblkhd); // arenas + mmapped blocks
+#else
+    return -1;
+#endif
+}
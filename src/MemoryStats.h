@@ -0,0 +1,133 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include "PureStaticClass.h"
+#include <QtGlobal>
+#include <atomic>
+
+/*!
+ * \brief Pure Static class counting the allocations per stage of the check (--memstats)
+ * - operator new is replaced in the nzbcheck command line only (MemoryHook.cpp, not in libnzbcheck):
+ *   when enabled, each allocation is accounted to the stage of its thread (set by a MemoryStage),
+ *   OTHER by default (Qt event loop...), when disabled it costs one relaxed atomic load per allocation
+ * - what doesn't go through operator new isn't counted there: the data of the Qt containers
+ *   (QString, QByteArray, QVector, QList, QHash nodes), OpenSSL and zlib use malloc directly.
+ *   With glibc 2.33+ the net growth of the malloc heap is also measured per MemoryStage (mallinfo2):
+ *   it covers them but it is process-wide, so only approximate while other threads allocate
+ */
+class MemoryStats : public PureStaticClass
+{
+public:
+    enum class Stage : int {OTHER = 0, PARSE, QUEUE, CONNECTION, OUTPUT, NB_STAGES};
+
+    static inline void setEnabled(bool enabled);
+    static inline bool isEnabled();
+
+    static inline void setHooked(); //!< operator new is replaced (MemoryHook.cpp)
+    static inline bool isHooked();
+    static inline void allocated(std::size_t size);
+
+    static qint64 nbAllocations(Stage stage);
+    static qint64 nbBytes(Stage stage);
+    static qint64 heapGrowth(Stage stage); //!< net bytes of malloc heap of its MemoryStages
+    static const char *stageName(Stage stage);
+
+    //! peak resident memory of the process in KB (-1 if not available)
+    static qint64 peakRssKB();
+    //! bytes in use in the malloc heap (-1 if not available: glibc 2.33+ only)
+    static qint64 heapInUse();
+
+private:
+    static const int sNbStages = static_cast<int>(Stage::NB_STAGES);
+
+    static std::atomic<bool>   sEnabled;
+    static bool                sHooked;
+    static std::atomic<qint64> sNbAllocations[sNbStages];
+    static std::atomic<qint64> sNbBytes[sNbStages];
+    static std::atomic<qint64> sHeapGrowth[sNbStages];
+    static thread_local Stage  sCurrentStage;
+    static thread_local qint64 sNestedGrowth; //!< heap growth of the MemoryStages nested in the current one
+
+    friend class MemoryStage;
+};
+
+/*!
+ * \brief scope accounting the allocations of its thread to a stage
+ * they can be nested, the previous stage is restored at the end of the scope
+ * measureHeap is false for the stages of the worker threads of a MemoryStage that already measures the heap
+ * (the heap is process-wide: it would be counted twice)
+ */
+class MemoryStage
+{
+public:
+    explicit inline MemoryStage(MemoryStats::Stage stage, bool measureHeap = true);
+    inline ~MemoryStage();
+
+    MemoryStage(const MemoryStage &other) = delete;
+    MemoryStage & operator=(const MemoryStage &other) = delete;
+
+private:
+    const MemoryStats::Stage _previous;
+    const MemoryStats::Stage _stage;
+    const qint64             _heapStart;   //!< -1 if not measured
+    const qint64             _outerNested; //!< nested growth of the enclosing MemoryStage
+};
+
+void MemoryStats::setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+bool MemoryStats::isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+void MemoryStats::setHooked() { sHooked = true; }
+bool MemoryStats::isHooked() { return sHooked; }
+
+void MemoryStats::allocated(std::size_t size)
+{
+    if (!sEnabled.load(std::memory_order_relaxed))
+        return;
+    int stage = static_cast<int>(sCurrentStage);
+    sNbAllocations[stage].fetch_add(1, std::memory_order_relaxed);
+    sNbBytes[stage].fetch_add(static_cast<qint64>(size), std::memory_order_relaxed);
+}
+
+MemoryStage::MemoryStage(MemoryStats::Stage stage, bool measureHeap)
+    : _previous(MemoryStats::sCurrentStage), _stage(stage),
+      _heapStart(measureHeap && MemoryStats::isEnabled() ? MemoryStats::heapInUse() : -1),
+      _outerNested(MemoryStats::sNestedGrowth)
+{
+    MemoryStats::sCurrentStage = stage;
+    MemoryStats::sNestedGrowth = 0;
+}
+
+MemoryStage::~MemoryStage()
+{
+    MemoryStats::sCurrentStage = _previous;
+    qint64 growth = 0;
+    if (_heapStart >= 0)
+    {
+        // the nested stages have their own share
+        growth = MemoryStats::heapInUse() - _heapStart;
+        MemoryStats::sHeapGrowth[static_cast<int>(_stage)].fetch_add(growth - MemoryStats::sNestedGrowth, std::memory_order_relaxed);
+    }
+    MemoryStats::sNestedGrowth = _outerNested + growth;
+}
+
+#endif // MEMORYSTATS_H
@@ -51,11 +51,19 @@ const std::map<unsigned short, const char *>  Nntp::sResponses = {
     {223, "223 0|n message-id    Article exists"},
     {430, "430 No article with that message-id"},
 
+    //rfc3977: 6.2.2.  HEAD
+    {221, "221 0|n message-id    Headers follow (multi-line)"},
+
 
     //rfc977: 3.11.2  The QUIT command
     {205, "205 closing connection - goodbye!"},
 
 
+    //rfc8054: 2.2.2  The COMPRESS command
+    {206, "206 Compression active"},
+    {403, "403 Unable to activate compression"},
+
+
     //rfc4643: 2.3.1
     {281, "281 Authentication accepted"},
     {380, "380 More Authentication Required"},
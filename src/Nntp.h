@@ -38,6 +38,8 @@ public:
     static constexpr const char* POST          {"post\r\n"};
     static constexpr const char* ENDLINE       {"\r\n"};
     static constexpr const char* STAT          {"stat"};
+    static constexpr const char* HEAD          {"head"};
+    static constexpr const char* COMPRESS      {"compress deflate\r\n"};
 
 
     //! return the response associated to a certain code
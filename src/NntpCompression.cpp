@@ -0,0 +1,79 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NntpCompression.h"
+
+NntpCompression::NntpCompression():
+    _inflater(), _deflater(), _isValid(false),
+    _nbBytesReceived(0), _nbBytesInflated(0), _nbBytesSent(0), _nbBytesDeflated(0)
+{
+    // negative window bits: raw DEFLATE as required by RFC 8054
+    _isValid = inflateInit2(&_inflater, -MAX_WBITS) == Z_OK
+            && deflateInit2(&_deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+NntpCompression::~NntpCompression()
+{
+    inflateEnd(&_inflater);
+    deflateEnd(&_deflater);
+}
+
+bool NntpCompression::inflate(const QByteArray &in, QByteArray &out)
+{
+    _nbBytesReceived += in.size();
+    _inflater.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(in.constData()));
+    _inflater.avail_in = static_cast<uInt>(in.size());
+    do
+    {
+        // inflate straight at the end of out
+        int size = out.size();
+        out.resize(size + sChunkSize);
+        _inflater.next_out  = reinterpret_cast<Bytef*>(out.data() + size);
+        _inflater.avail_out = sChunkSize;
+        int res = ::inflate(&_inflater, Z_SYNC_FLUSH);
+        out.resize(size + sChunkSize - static_cast<int>(_inflater.avail_out));
+        _nbBytesInflated += sChunkSize - _inflater.avail_out;
+        if (res == Z_STREAM_END)
+            return true; // the server ended the stream
+        if (res != Z_OK && res != Z_BUF_ERROR)
+            return false;
+    } while (_inflater.avail_in > 0 || _inflater.avail_out == 0);
+    return true;
+}
+
+QByteArray NntpCompression::deflate(const QByteArray &in)
+{
+    _nbBytesDeflated += in.size();
+    _deflater.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(in.constData()));
+    _deflater.avail_in = static_cast<uInt>(in.size());
+    QByteArray out;
+    do
+    {
+        int size = out.size();
+        out.resize(size + sChunkSize);
+        _deflater.next_out  = reinterpret_cast<Bytef*>(out.data() + size);
+        _deflater.avail_out = sChunkSize;
+        ::deflate(&_deflater, Z_SYNC_FLUSH);
+        out.resize(size + sChunkSize - static_cast<int>(_deflater.avail_out));
+    } while (_deflater.avail_out == 0);
+    _nbBytesSent += out.size();
+    return out;
+}
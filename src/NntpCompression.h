@@ -0,0 +1,72 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NNTPCOMPRESSION_H
+#define NNTPCOMPRESSION_H
+
+#include <QByteArray>
+#include <zlib.h>
+
+/*!
+ * \brief both directions of a connection compressed with COMPRESS DEFLATE (RFC 8054)
+ * raw DEFLATE streams (no zlib header): the replies are inflated as they arrive,
+ * appended to the caller's buffer, the commands are deflated with a sync flush
+ */
+class NntpCompression
+{
+public:
+    NntpCompression();
+    ~NntpCompression();
+
+    NntpCompression(const NntpCompression &other) = delete;
+    NntpCompression & operator=(const NntpCompression &other) = delete;
+
+    inline bool isValid() const;
+
+    //! inflate the received bytes at the end of out, false on a corrupted stream
+    bool inflate(const QByteArray &in, QByteArray &out);
+    //! the complete command, flushed so the server can read it
+    QByteArray deflate(const QByteArray &in);
+
+    inline qint64 nbBytesReceived() const; //!< compressed
+    inline qint64 nbBytesInflated() const;
+    inline qint64 nbBytesSent() const;     //!< compressed
+    inline qint64 nbBytesDeflated() const;
+
+private:
+    z_stream _inflater;
+    z_stream _deflater;
+    bool     _isValid;
+    qint64   _nbBytesReceived;
+    qint64   _nbBytesInflated;
+    qint64   _nbBytesSent;
+    qint64   _nbBytesDeflated;
+
+    static const int sChunkSize = 16384;
+};
+
+bool NntpCompression::isValid() const { return _isValid; }
+qint64 NntpCompression::nbBytesReceived() const { return _nbBytesReceived; }
+qint64 NntpCompression::nbBytesInflated() const { return _nbBytesInflated; }
+qint64 NntpCompression::nbBytesSent() const { return _nbBytesSent; }
+qint64 NntpCompression::nbBytesDeflated() const { return _nbBytesDeflated; }
+
+#endif // NNTPCOMPRESSION_H
@@ -22,17 +22,28 @@
 #include "NntpCon.h"
 #include "NzbCheck.h"
 #include "Nntp.h"
+#include "MemoryStats.h"
 #include <QSslSocket>
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
 
-NntpCon::NntpCon(NzbCheck *nzbCheck, int id, const NntpServerParams &srvParams)
+NntpCon::NntpCon(NzbCheck *nzbCheck, int id, const NntpServerParams &srvParams, TraceBuffer *trace)
     : QObject(),
       _nzbCheck(nzbCheck), _id(id), _srvParams(srvParams),
-      _socket(nullptr), _isConnected(false),
+      _socket(nullptr), _isConnected(false), _isClosing(false), _loggedIn(false), _authRefused(false),
       _postingState(PostingState::NOT_CONNECTED),
-      _currentArticle()
+      _scheduler(nzbCheck->scheduler()), _unsent(), _inFlight(),
+      _recorder(nzbCheck->recorder()),
+      _compression(nullptr), _inflated(), _inflatedPos(0),
+      _readingHead(false), _head(), _inSubject(false),
+      _adopted(false), _proxy(nullptr), _proxyReturned(false),
+      _trace(trace), _spanStart(0), _lastReply(-1)
 {
     connect(this, &NntpCon::startConnection, this, &NntpCon::onStartConnection, Qt::QueuedConnection);
     connect(this, &NntpCon::killConnection,  this, &NntpCon::onKillConnection,  Qt::QueuedConnection);
+    connect(this, &NntpCon::adoptSocket,     this, &NntpCon::onAdoptSocket,     Qt::QueuedConnection);
+    connect(this, &NntpCon::wakeUp,          this, &NntpCon::onWakeUp,          Qt::QueuedConnection);
 }
 
 NntpCon::~NntpCon()
@@ -41,66 +52,216 @@ NntpCon::~NntpCon()
     {
         disconnect(_socket, &QAbstractSocket::disconnected, this, &NntpCon::onDisconnected);
         disconnect(_socket, &QIODevice::readyRead,          this, &NntpCon::onReadyRead);
-        _socket->disconnectFromHost();
-        if (_socket->state() != QAbstractSocket::UnconnectedState)
-            _socket->waitForDisconnected();
+        _socket->abort(); // never block at teardown
         _socket->deleteLater();
     }
+    if (_compression)
+        delete _compression;
+    if (_proxy)
+    {
+        _proxy->disconnect(this);
+        _proxy->abort();
+        _proxy->deleteLater();
+    }
 }
 
 void NntpCon::onStartConnection()
 {
-    if (_srvParams.useSSL)
+    MemoryStage memoryStage(MemoryStats::Stage::CONNECTION);
+    if (_nzbCheck->replayMode())
+        _socket = _nzbCheck->newReplaySocket(_srvParams, _id);
+    else if (_srvParams.useSSL)
         _socket = new QSslSocket();
     else
         _socket = new QTcpSocket();
 
+    _connectSocket();
+    connect(_socket, &QAbstractSocket::connected,    this, &NntpCon::onConnected,    Qt::DirectConnection);
+
+    _traceStart();
+    _record(SessionRecorder::Event::CONNECTING);
+    _socket->connectToHost(_srvParams.host, _srvParams.port);
+
+#ifdef __USE_CONNECTION_TIMEOUT__
+    if (!_timeout)
+    {
+        _timeout = new QTimer();
+        connect(_timeout, &QTimer::timeout, this, &NntpCon::onTimeout);
+    }
+    _timeout->start(_ngPost->getSocketTimeout());
+#endif
+}
+
+void NntpCon::onAdoptSocket(int socketDescriptor)
+{
+    _socket = new QTcpSocket();
+    if (!_socket->setSocketDescriptor(socketDescriptor))
+    {
+        _nzbCheck->error(tr("[Con #%1] Error adopting the socket: %2").arg(_id).arg(_socket->errorString()));
+        delete _socket;
+        _socket = nullptr;
+        emit disconnected(this);
+        return;
+    }
+    _connectSocket();
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("[Con #%1] Adopted (already authenticated)").arg(_id));
+
+    _isConnected  = true;
+    _adopted      = true;
+    _loggedIn     = true;
+    _postingState = PostingState::IDLE;
+    _checkNextArticle();
+}
+
+void NntpCon::_connectSocket()
+{
     _socket->setSocketOption(QAbstractSocket::KeepAliveOption, true);
     _socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
 
-    connect(_socket, &QAbstractSocket::connected,    this, &NntpCon::onConnected,    Qt::DirectConnection);
     connect(_socket, &QAbstractSocket::disconnected, this, &NntpCon::onDisconnected, Qt::DirectConnection);
     connect(_socket, &QIODevice::readyRead,          this, &NntpCon::onReadyRead,    Qt::DirectConnection);
 
     qRegisterMetaType<QAbstractSocket::SocketError>("SocketError" );
     connect(_socket, SIGNAL(error(QAbstractSocket::SocketError)),
             this, SLOT(onErrors(QAbstractSocket::SocketError)), Qt::DirectConnection);
+}
 
-    _socket->connectToHost(_srvParams.host, _srvParams.port);
+int NntpCon::detachSocket()
+{
+#if defined(Q_OS_UNIX)
+    if (!_socket || !_isConnected || _isClosing || _srvParams.useSSL || _compression || !_inFlight.isEmpty())
+        return -1;
 
-#ifdef __USE_CONNECTION_TIMEOUT__
-    if (!_timeout)
+    // the dup keeps the TCP connection open when our socket is closed
+    int fd = ::dup(static_cast<int>(_socket->socketDescriptor()));
+    if (fd < 0)
+        return -1;
+    _releaseArticles();
+    _socket->disconnect(this);
+    _socket->abort();
+    _socket->deleteLater();
+    _socket       = nullptr;
+    _isConnected  = false;
+    _postingState = PostingState::NOT_CONNECTED;
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+void NntpCon::proxy(QTcpSocket *peer)
+{
+    _proxy         = peer;
+    _proxyReturned = false;
+    connect(_proxy, &QIODevice::readyRead,          this, &NntpCon::onProxyReadyRead,    Qt::DirectConnection);
+    connect(_proxy, &QAbstractSocket::disconnected, this, &NntpCon::onProxyDisconnected, Qt::DirectConnection);
+    onProxyReadyRead(); // the borrower may have been fast
+}
+
+void NntpCon::onProxyReadyRead()
+{
+    if (_socket && _isConnected)
+        _socket->write(_proxy->readAll());
+}
+
+void NntpCon::onProxyDisconnected()
+{
+    QTcpSocket *peer = _proxy;
+    _proxy = nullptr;
+    peer->disconnect(this);
+    peer->deleteLater();
+    if (_proxyReturned)
     {
-        _timeout = new QTimer();
-        connect(_timeout, &QTimer::timeout, this, &NntpCon::onTimeout);
+        if (_nzbCheck->debugMode())
+            _nzbCheck->log(tr("[Con #%1] Given back").arg(_id));
     }
-    _timeout->start(_ngPost->getSocketTimeout());
-#endif
+    else
+        _closeConnection(); // the borrower died: we may be in the middle of a reply (reopened by the pool)
 }
 
 void NntpCon::onKillConnection()
 {
-    if (_socket)
+    // non blocking: we'll be disconnected once the QUIT is written
+    _closeConnection();
+}
+
+void NntpCon::onWakeUp()
+{
+    if (_isConnected && (_postingState == PostingState::IDLE || _postingState == PostingState::CHECKING_ARTICLE))
+        _checkNextArticle();
+}
+
+int NntpCon::nbUnsentFor(const NntpServerParams &srvParams) const
+{
+    int nbArticles = 0;
+    for (const ScheduledArticle &article : _unsent)
     {
-        disconnect(_socket, &QIODevice::readyRead,          this, &NntpCon::onReadyRead);
-        disconnect(_socket, &QAbstractSocket::disconnected, this, &NntpCon::onDisconnected);
-        _socket->disconnectFromHost();
-        if (_socket->state() != QAbstractSocket::UnconnectedState)
-            _socket->waitForDisconnected();
-        _socket->deleteLater();
-        _socket = nullptr;
+        if (srvParams.covers(article.ageDays))
+            ++nbArticles;
     }
+    return nbArticles;
+}
+
+void NntpCon::giveUnsent(int nbArticles, QQueue<ScheduledArticle> &to, const NntpServerParams &srvParams)
+{
+    for (int i = _unsent.size() - 1; i >= 0 && nbArticles > 0; --i)
+    {
+        if (srvParams.covers(_unsent.at(i).ageDays))
+        {
+            to.enqueue(_unsent.takeAt(i));
+            --nbArticles;
+        }
+    }
+}
+
+void NntpCon::dropUnsent()
+{
+    for (const ScheduledArticle &article : _unsent)
+        _nzbCheck->articleNotChecked(article.job, article.msgId);
+    _unsent.clear();
+    if (_isConnected && _inFlight.isEmpty() && _postingState == PostingState::IDLE)
+        _checkNextArticle(); // nothing more to do
+}
+
+void NntpCon::hedge(const ScheduledArticle &article)
+{
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("[Con #%1] Hedging article %2").arg(_id).arg(article.msgId));
+
+    ScheduledArticle copy = article;
+    copy.sentTime = _scheduler->now();
+    _write(_checkCommand(copy.msgId));
+    _inFlight.enqueue(copy);
+    _postingState = PostingState::CHECKING_ARTICLE;
 }
 
 void NntpCon::onConnected()
 {
     _isConnected = true;
+    _traceEnd("connect");
+    _record(SessionRecorder::Event::CONNECTED);
+    _traceStart();
     if (_srvParams.useSSL)
     {
         QSslSocket *sslSock = static_cast<QSslSocket*>(_socket);
         connect(sslSock, SIGNAL(sslErrors(QList<QSslError>)),
                 this, SLOT(onSslErrors(QList<QSslError>)), Qt::DirectConnection);
 
+        if (_nzbCheck->tlsResumeMode())
+        {
+            // resume the session of a previous connection: no key exchange nor certificate check
+            QSslConfiguration conf = sslSock->sslConfiguration();
+            conf.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+            QByteArray ticket = _nzbCheck->sessionTicket(_srvParams);
+            if (!ticket.isEmpty())
+                conf.setSessionTicket(ticket);
+            sslSock->setSslConfiguration(conf);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+            connect(sslSock, &QSslSocket::newSessionTicketReceived, this, &NntpCon::onNewSessionTicket, Qt::DirectConnection);
+#endif
+        }
+
         connect(sslSock, &QSslSocket::encrypted, this, &NntpCon::onEncrypted, Qt::DirectConnection);
         emit sslSock->startClientEncryption();
     }
@@ -116,6 +277,9 @@ void NntpCon::onConnected()
 
 void NntpCon::onEncrypted()
 {
+    _traceEnd("TLS handshake");
+    _traceStart();
+    _record(SessionRecorder::Event::ENCRYPTED);
     if (_nzbCheck->debugMode())
         _nzbCheck->log(tr("[Con #%1] Connected").arg(_id));
 
@@ -123,8 +287,35 @@ void NntpCon::onEncrypted()
     // We should receive the Hello Message
 }
 
+void NntpCon::onNewSessionTicket()
+{
+    _giveSessionTicket();
+}
+
+void NntpCon::_giveSessionTicket()
+{
+    QSslSocket *sslSock = static_cast<QSslSocket*>(_socket);
+    _nzbCheck->sessionReady(_srvParams, sslSock->sslConfiguration().sessionTicket());
+}
+
 void NntpCon::onDisconnected()
 {
+    if (_isClosing)
+        _traceEnd("disconnect"); // since our QUIT
+    else
+        _traceStart();           // closed by the server: nothing of ours to time
+    if (_proxy)
+    {
+        // the borrower will see it closed
+        _proxy->disconnect(this);
+        _proxy->disconnectFromHost();
+        _proxy->deleteLater();
+        _proxy = nullptr;
+    }
+    if (_compression)
+        _nzbCheck->addCompressionStats(*_compression);
+    _record(SessionRecorder::Event::DISCONNECTED);
+    _releaseArticles();
     if (_socket)
     {
         _isConnected    = false;
@@ -136,22 +327,54 @@ void NntpCon::onDisconnected()
 
 void NntpCon::onReadyRead()
 {
-    while (_isConnected && _socket->canReadLine())
+    MemoryStage memoryStage(MemoryStats::Stage::CONNECTION);
+    if (_proxy)
     {
-        QByteArray line = _socket->readLine();
+        _proxy->write(_socket->readAll()); // lent (--broker): the borrower reads the replies
+        return;
+    }
+
+    QByteArray line;
+    while (_isConnected && _readLine(line))
+    {
+        _record(SessionRecorder::Event::RECEIVED, line);
 //        qDebug() << "line: " << line.constData();
 
         if (_postingState == PostingState::CHECKING_ARTICLE)
         {
-            if(strncmp(line.constData(), Nntp::getResponse(430), 3) == 0)
-                _nzbCheck->missingArticle(_currentArticle);
-
-            _nzbCheck->articleChecked();
-            _postingState = PostingState::IDLE;
-            _checkNextArticle();
+            if (_readingHead)
+            {
+                if (line == ".\r\n" || line == ".\n")
+                {
+                    _readingHead = false;
+                    _articleReplied(false);
+                }
+                else
+                    _readHeader(line);
+            }
+            else if (_nzbCheck->headMode() && strncmp(line.constData(), Nntp::getResponse(221), 3) == 0)
+            {
+                _readingHead = true; // multi-line reply
+                _head        = ArticleHead();
+                _inSubject   = false;
+            }
+            else if (strncmp(line.constData(), Nntp::getResponse(430), 3) == 0)
+                _articleReplied(true);
+            else if (_nzbCheck->headMode())
+            {
+                // only a 221 tells the Article is there (423, 5xx...)
+                _nzbCheck->error(tr("[Con #%1] Unexpected reply to HEAD %2: %3").arg(_id).arg(
+                                     _inFlight.isEmpty() ? QString() : _inFlight.head().msgId).arg(line.trimmed().constData()));
+                _articleReplied(true);
+            }
+            else
+                _articleReplied(false);
         }
         else if (_postingState == PostingState::CONNECTED)
         {
+            _traceEnd("welcome");
+            if (_srvParams.useSSL && _nzbCheck->tlsResumeMode())
+                _giveSessionTicket(); // TLS 1.2: given with the handshake, TLS 1.3: received with the welcome
             // Check welcome message
             if(strncmp(line.constData(), Nntp::getResponse(200), 3) != 0){
                 emit errorConnecting(tr("[Connection #%1] Error connecting to server %2:%3").arg(
@@ -162,18 +385,16 @@ void NntpCon::onReadyRead()
             {
                 // Start authentication : send user info
                 if (_srvParams.user.empty())
-                {
-                    _postingState = PostingState::IDLE;
-                    _checkNextArticle();
-                }
+                    _startChecking();
                 else
                 {
                     _postingState = PostingState::AUTH_USER;
+                    _traceStart();
 
                     std::string cmd(Nntp::AUTHINFO_USER);
                     cmd += _srvParams.user;
                     cmd += Nntp::ENDLINE;
-                    _socket->write(cmd.c_str());
+                    _write(cmd.c_str());
                 }
             }
         }
@@ -183,6 +404,7 @@ void NntpCon::onReadyRead()
             if(strncmp(line.constData(), Nntp::getResponse(381), 2) != 0){
                 emit errorConnecting(tr("[Connection #%1] Error sending user '%4' to server %2:%3").arg(
                                          _id).arg(_srvParams.host).arg(_srvParams.port).arg(_srvParams.user.c_str()));
+                _authRefused = _isAuthRefusal(line);
                 _closeConnection();
             }
             else
@@ -193,7 +415,7 @@ void NntpCon::onReadyRead()
                 std::string cmd(Nntp::AUTHINFO_PASS);
                 cmd += _srvParams.pass;
                 cmd += Nntp::ENDLINE;
-                _socket->write(cmd.c_str());
+                _write(cmd.c_str());
             }
         }
         else if (_postingState == PostingState::AUTH_PASS)
@@ -202,17 +424,150 @@ void NntpCon::onReadyRead()
                 emit errorConnecting(tr("[Connection #%1] Error authentication to server %2:%3 with user '%4' and pass '%5'").arg(
                                          _id).arg(_srvParams.host).arg(_srvParams.port).arg(
                                          _srvParams.user.c_str()).arg(_srvParams.pass.c_str()));
+                _authRefused = _isAuthRefusal(line);
                 _closeConnection();
             }
             else
             {
-                _postingState = PostingState::IDLE;
-                _checkNextArticle();
+                _traceEnd("AUTHINFO");
+                _startChecking();
+            }
+        }
+        else if (_postingState == PostingState::COMPRESS)
+        {
+            _traceEnd("COMPRESS");
+            if (strncmp(line.constData(), Nntp::getResponse(206), 3) == 0)
+            {
+                // the following bytes are compressed in both directions
+                _compression = new NntpCompression();
+                if (!_compression->isValid())
+                {
+                    _nzbCheck->error(tr("[Con #%1] Error initializing zlib").arg(_id));
+                    _closeConnection();
+                    return;
+                }
             }
+            else if (_nzbCheck->debugMode())
+                _nzbCheck->log(tr("[Con #%1] COMPRESS DEFLATE not available: %2").arg(_id).arg(line.trimmed().constData()));
+
+            _postingState = PostingState::IDLE;
+            _checkNextArticle();
         }
     }
 }
 
+void NntpCon::_articleReplied(bool missing)
+{
+    if (_inFlight.isEmpty())
+    {
+        // a reply we didn't ask for: the next ones can't be matched with their Article anymore
+        _nzbCheck->error(tr("[Con #%1] Protocol error: reply without any command in flight").arg(_id));
+        _closeConnection(); // gives the Articles of the connection back
+        return;
+    }
+
+    ScheduledArticle article = _inFlight.dequeue();
+    qint64 latency = _scheduler->now() - article.sentTime;
+    _scheduler->replied(this, latency);
+
+    if (_trace)
+    {
+        if (_nzbCheck->headMode())
+            _trace->addSpan(missing ? "HEAD (430)" : "HEAD", _trace->now() - latency);
+        else
+            _trace->addSpan(missing ? "STAT (430)" : "STAT", _trace->now() - latency);
+        _lastReply = _trace->now();
+    }
+    if (_scheduler->firstReply(article))
+    {
+        if (_nzbCheck->headMode() && !missing)
+            _nzbCheck->articleHeadChecked(article.job, article.msgId, _head);
+        else
+            _nzbCheck->articleChecked(article.job, article.msgId, missing);
+    }
+    _checkNextArticle();
+}
+
+QByteArray NntpCon::_checkCommand(const QString &msgId) const
+{
+    return QString("%1 %2\r\n").arg(_nzbCheck->headMode() ? Nntp::HEAD : Nntp::STAT).arg(msgId).toLocal8Bit();
+}
+
+void NntpCon::_readHeader(const QByteArray &line)
+{
+    // only the headers we compare with the nzb
+    if (line.startsWith(' ') || line.startsWith('\t'))
+    {
+        if (_inSubject)
+            _head.subject += QString::fromUtf8(line).trimmed().prepend(' '); // folded Subject
+        return;
+    }
+
+    int colon = line.indexOf(':');
+    _inSubject = false;
+    if (colon < 0)
+        return;
+    QByteArray name = line.left(colon).toLower(), value = line.mid(colon + 1).trimmed();
+    _inSubject = name == "subject";
+    if (name == "subject")
+        _head.subject = QString::fromUtf8(value);
+    else if (name == "bytes")
+        _head.bytes = value.toLongLong();
+    else if (name == "lines")
+        _head.lines = value.toInt();
+}
+
+void NntpCon::_startChecking()
+{
+    _loggedIn = true;
+    if (_nzbCheck->compressMode())
+    {
+        _postingState = PostingState::COMPRESS;
+        _traceStart();
+        _write(Nntp::COMPRESS);
+    }
+    else
+    {
+        _postingState = PostingState::IDLE;
+        _checkNextArticle();
+    }
+}
+
+bool NntpCon::_isAuthRefusal(const QByteArray &line)
+{
+    return strncmp(line.constData(), Nntp::getResponse(481), 3) == 0
+            || strncmp(line.constData(), Nntp::getResponse(482), 3) == 0;
+}
+
+bool NntpCon::_readLine(QByteArray &line)
+{
+    if (!_compression)
+    {
+        if (!_socket->canReadLine())
+            return false;
+        line = _socket->readLine();
+        return true;
+    }
+
+    if (_socket->bytesAvailable() > 0 && !_compression->inflate(_socket->readAll(), _inflated))
+    {
+        _nzbCheck->error(tr("[Con #%1] Error: corrupted compressed stream").arg(_id));
+        _closeConnection();
+        return false;
+    }
+    int end = _inflated.indexOf('\n', _inflatedPos);
+    if (end < 0)
+    {
+        // only keep the partial line
+        _inflated.remove(0, _inflatedPos);
+        _inflatedPos = 0;
+        return false;
+    }
+    line = _inflated.mid(_inflatedPos, end + 1 - _inflatedPos);
+    _inflatedPos = end + 1;
+    return true;
+}
+
 void NntpCon::onSslErrors(const QList<QSslError> &errors)
 {
     QString err("Error SSL Socket:\n");
@@ -231,10 +586,18 @@ void NntpCon::onErrors(QAbstractSocket::SocketError)
 
 void NntpCon::_closeConnection()
 {
+    if (_isClosing)
+        return;
+    _isClosing = true;
+
+    _traceStart();
+    _releaseArticles();
+    _postingState = PostingState::NOT_CONNECTED;
     if (_socket && _isConnected)
     {
         disconnect(_socket, &QIODevice::readyRead, this, &NntpCon::onReadyRead);
-        _socket->disconnectFromHost();
+        _write(Nntp::QUIT);
+        _socket->disconnectFromHost(); // after the pending writes
     }
     else // wrong host info or network down
     {
@@ -247,22 +610,67 @@ void NntpCon::_closeConnection()
 
 void NntpCon::_checkNextArticle()
 {
-    _currentArticle = _nzbCheck->getNextArticle();
-
-    if (!_currentArticle.isNull())
+    MemoryStage memoryStage(MemoryStats::Stage::CONNECTION);
+    // keep pipelineDepth STAT in flight (RFC 3977 3.5)
+    while (_inFlight.size() < _scheduler->pipelineDepth())
     {
+        if (_unsent.isEmpty())
+        {
+            _scheduler->refill(this, _unsent);
+            if (_unsent.isEmpty())
+                break;
+        }
+
+        ScheduledArticle article = _unsent.dequeue();
         if (_nzbCheck->debugMode())
-            _nzbCheck->log(tr("[Con #%1] Checking article %2").arg(_id).arg(_currentArticle));
+            _nzbCheck->log(tr("[Con #%1] Checking article %2").arg(_id).arg(article.msgId));
 
-        _postingState = PostingState::CHECKING_ARTICLE;
-        _socket->write(QString("%1 %2\r\n").arg(Nntp::STAT).arg(_currentArticle).toLocal8Bit());
+        if (_trace && _lastReply >= 0)
+        {
+            // the connection waited from its last reply to this send (refill or idle)
+            _trace->addSpan("getNextArticle", _lastReply);
+            _lastReply = -1;
+        }
+        article.sentTime = _scheduler->now();
+        _write(_checkCommand(article.msgId));
+        _inFlight.enqueue(article);
     }
+
+    if (!_inFlight.isEmpty())
+        _postingState = PostingState::CHECKING_ARTICLE;
     else
     {
         if (_nzbCheck->debugMode())
             _nzbCheck->log(tr("[Con #%1] No more Article").arg(_id));
 
         _postingState = PostingState::IDLE;
-        _closeConnection();
+        if (!_nzbCheck->poolMode() && !_scheduler->canHedge() && !_adopted)
+            _closeConnection(); // otherwise we stay to take the stragglers (or to be given back)
     }
 }
+
+void NntpCon::_write(const QByteArray &cmd)
+{
+    _record(SessionRecorder::Event::SENT, cmd);
+    if (_compression)
+        _socket->write(_compression->deflate(cmd));
+    else
+        _socket->write(cmd);
+}
+
+void NntpCon::_releaseArticles()
+{
+    // the connection is lost: give its Articles back
+    for (const ScheduledArticle &article : _inFlight)
+    {
+        if (!_scheduler->releaseHedged(article))
+            _nzbCheck->articleNotChecked(article.job, article.msgId);
+    }
+    for (const ScheduledArticle &article : _unsent)
+        _nzbCheck->articleNotChecked(article.job, article.msgId);
+    _inFlight.clear();
+    _unsent.clear();
+    _readingHead = false;
+    if (_postingState == PostingState::CHECKING_ARTICLE)
+        _postingState = PostingState::IDLE;
+}
@@ -22,6 +22,11 @@
 #ifndef NNTPCON_H
 #define NNTPCON_H
 #include "NntpServerParams.h"
+#include "TraceRecorder.h"
+#include "NntpScheduler.h"
+#include "SessionRecorder.h"
+#include "NntpCompression.h"
+#include "NzbJob.h"
 class NzbCheck;
 
 #include <QObject>
@@ -36,7 +41,7 @@ class NntpCon : public QObject
 
 private:
     enum class PostingState {NOT_CONNECTED = 0, CONNECTED,
-                             AUTH_USER, AUTH_PASS,
+                             AUTH_USER, AUTH_PASS, COMPRESS,
                              IDLE, CHECKING_ARTICLE};
 
     NzbCheck *const        _nzbCheck;
@@ -45,17 +50,66 @@ private:
 
     QTcpSocket   *_socket;         //!< Real TCP socket
     bool          _isConnected;    //!< to avoid to rely on iSocket && iSocket->isOpen()
+    bool          _isClosing;      //!< QUIT sent (or closing), don't close twice
+    bool          _loggedIn;       //!< reached IDLE (connected and authenticated)
+    bool          _authRefused;    //!< the server refused our credentials (481/482): retrying is useless
 
     PostingState   _postingState;
-    QString        _currentArticle;
+
+    NntpScheduler *const     _scheduler;
+    QQueue<ScheduledArticle> _unsent;   //!< batch given by the scheduler (can be stolen by another connection)
+    QQueue<ScheduledArticle> _inFlight; //!< STAT sent, waiting for their reply (in order)
+
+    SessionRecorder *const _recorder; //!< nullptr if the session is not recorded (--record)
+
+    NntpCompression *_compression; //!< nullptr until COMPRESS DEFLATE is active (--compress)
+
+    QByteArray       _inflated;    //!< inflated replies not read yet (from _inflatedPos)
+    int              _inflatedPos;
+
+    bool             _readingHead; //!< between the 221 and the final dot of a HEAD reply
+    ArticleHead      _head;        //!< headers of the HEAD being read
+    bool             _inSubject;   //!< the last header read is the Subject: its continuation lines are folded into it
+
+    bool             _adopted;       //!< socket already connected and authenticated (given by a broker), never QUIT
+    QTcpSocket      *_proxy;         //!< --broker: the borrower of this SSL connection (we forward the stream)
+    bool             _proxyReturned; //!< the borrower gave it back in a clean state
+
+    TraceBuffer   *_trace;     //!< nullptr if the run is not traced
+    qint64         _spanStart; //!< start of the current traced step
+    qint64         _lastReply; //!< time of the last reply, start of the gap until the next send (-1 if none)
 
 public:
-    NntpCon(NzbCheck *nzbCheck, int id, const NntpServerParams &srvParams);
+    NntpCon(NzbCheck *nzbCheck, int id, const NntpServerParams &srvParams, TraceBuffer *trace = nullptr);
     ~NntpCon();
 
+    inline int id() const;
+    inline const NntpServerParams &srvParams() const;
+
+    inline bool loggedIn() const;
+    inline bool authRefused() const;
+
+    inline int nbUnsent() const;
+    int nbUnsentFor(const NntpServerParams &srvParams) const; //!< unsent Articles within the retention of srvParams
+    inline const NntpCompression *compression() const;
+    //! the last nbArticles unsent Articles within the retention of srvParams (NntpScheduler::_steal)
+    void giveUnsent(int nbArticles, QQueue<ScheduledArticle> &to, const NntpServerParams &srvParams);
+    void dropUnsent(); //!< the dispatch is stopped (--deadline): give them back and only wait for the replies
+
+    inline const ScheduledArticle *oldestInFlight() const;
+    inline bool isIdle() const;
+    void hedge(const ScheduledArticle &article); //!< duplicate STAT of a straggler of another connection
+
+    int  detachSocket(); //!< plain connection lent or given back to a broker: dup of its descriptor (-1 if not possible)
+    void proxy(QTcpSocket *peer); //!< SSL connection lent by a broker: forward its decrypted stream to peer
+    inline void proxyReturned();
+    inline bool isProxying() const;
+
 signals:
     void startConnection();
     void killConnection();
+    void adoptSocket(int socketDescriptor); //!< start on a socket already connected and authenticated (IDLE)
+    void wakeUp(); //!< new Articles to check
 
 //    void error(QTcpSocket::SocketError socketerror); //!< Socket Error
     void socketError(QString aError);                //!< Error during socket creation (ssl or not)
@@ -65,11 +119,14 @@ signals:
 
 public slots:
     void onStartConnection();
+    void onAdoptSocket(int socketDescriptor);
     void onKillConnection();
+    void onWakeUp();
 
 
     void onConnected();
     void onEncrypted();
+    void onNewSessionTicket(); //!< TLS 1.3: the ticket comes after the handshake (--tls-resume)
 
     void onDisconnected();    //!< Handle disconnection
 
@@ -77,10 +134,60 @@ public slots:
     void onSslErrors(const QList<QSslError> &errors); //!< SSL errors handler
     void onErrors(QAbstractSocket::SocketError);      //!< Socket errors handler
 
+    void onProxyReadyRead();
+    void onProxyDisconnected();
+
 
 private:
+    void _connectSocket();
     void _closeConnection();
     void _checkNextArticle();
+    void _releaseArticles();
+    void _write(const QByteArray &cmd);
+    bool _readLine(QByteArray &line);
+    void _giveSessionTicket();
+    void _readHeader(const QByteArray &line);
+    void _articleReplied(bool missing);
+    QByteArray _checkCommand(const QString &msgId) const; //!< STAT or HEAD (--head)
+    void _startChecking(); //!< connected and authenticated
+    static bool _isAuthRefusal(const QByteArray &line);
+
+    inline void _record(SessionRecorder::Event event, const QByteArray &data = QByteArray());
+
+    inline void _traceStart();
+    inline void _traceEnd(const char *spanName);
 };
 
+int NntpCon::id() const { return _id; }
+const NntpServerParams &NntpCon::srvParams() const { return _srvParams; }
+bool NntpCon::loggedIn() const { return _loggedIn; }
+bool NntpCon::authRefused() const { return _authRefused; }
+int NntpCon::nbUnsent() const { return _unsent.size(); }
+const NntpCompression *NntpCon::compression() const { return _compression; }
+const ScheduledArticle *NntpCon::oldestInFlight() const { return _inFlight.isEmpty() ? nullptr : &_inFlight.head(); }
+void NntpCon::proxyReturned() { _proxyReturned = true; }
+bool NntpCon::isProxying() const { return _proxy != nullptr; }
+bool NntpCon::isIdle() const
+{
+    return _isConnected && !_isClosing && _postingState == PostingState::IDLE && _inFlight.isEmpty() && _unsent.isEmpty();
+}
+
+void NntpCon::_record(SessionRecorder::Event event, const QByteArray &data)
+{
+    if (_recorder)
+        _recorder->add(_srvParams, _id, event, data);
+}
+
+void NntpCon::_traceStart()
+{
+    if (_trace)
+        _spanStart = _trace->now();
+}
+
+void NntpCon::_traceEnd(const char *spanName)
+{
+    if (_trace)
+        _trace->addSpan(spanName, _spanStart);
+}
+
 #endif // NNTPCON_H
@@ -0,0 +1,241 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NntpScheduler.h"
+#include "NntpCon.h"
+#include "NzbCheck.h"
+#include <algorithm>
+
+const double NntpScheduler::sAlpha = 0.2;
+const double NntpScheduler::sHedgePercentile = 0.95;
+
+void NntpScheduler::Latency::add(double latency)
+{
+    ewma = nbReplies ? sAlpha * latency + (1. - sAlpha) * ewma : latency;
+    ++nbReplies;
+}
+
+NntpScheduler::NntpScheduler(NzbCheck *nzbCheck, int pipelineDepth):
+    _nzbCheck(nzbCheck), _pipelineDepth(pipelineDepth), _clock(),
+    _conLatencies(), _srvLatencies(), _nbStolen(0),
+    _samples(sNbSamples, 0.), _nbSamples(0), _hedges(), _maxHedges(0), _nbHedges(0), _nbHedgeWins(0)
+{
+    _clock.start();
+}
+
+void NntpScheduler::addConnection(NntpCon *con)
+{
+    _conLatencies.insert(con, Latency());
+    if (!_srvLatencies.contains(&con->srvParams()))
+        _srvLatencies.insert(&con->srvParams(), Latency());
+}
+
+void NntpScheduler::removeConnection(NntpCon *con)
+{
+    _conLatencies.remove(con);
+}
+
+void NntpScheduler::refill(NntpCon *con, QQueue<ScheduledArticle> &unsent)
+{
+    int batchSize = _batchSize(con);
+    for (int i = 0; i < batchSize; ++i)
+    {
+        NzbJob *job = nullptr;
+        QString msgId = _nzbCheck->getNextArticle(job, &con->srvParams());
+        if (msgId.isNull())
+            break;
+        unsent.enqueue({msgId, job, 0, false, job->articleAges.value(msgId, 0)});
+    }
+
+    if (unsent.isEmpty())
+        _steal(con, unsent);
+}
+
+void NntpScheduler::replied(NntpCon *con, qint64 latency)
+{
+    double latencyMs = latency / 1e6;
+    _conLatencies[con].add(latencyMs);
+    _srvLatencies[&con->srvParams()].add(latencyMs);
+    _samples[_nbSamples++ % sNbSamples] = latencyMs;
+}
+
+void NntpScheduler::hedgeStragglers()
+{
+    if (!canHedge() || _nbSamples < sMinHedgeSamples)
+        return;
+
+    qint64 threshold = static_cast<qint64>(_percentile(sHedgePercentile) * 1e6), now = _clock.nsecsElapsed();
+    for (auto it = _conLatencies.cbegin(), itEnd = _conLatencies.cend(); it != itEnd && canHedge(); ++it)
+    {
+        // replies come in order: only the oldest STAT can be a straggler
+        const ScheduledArticle *straggler = it.key()->oldestInFlight();
+        if (!straggler || straggler->hedge || _hedges.contains(_hedgeKey(*straggler))
+                || now - straggler->sentTime < threshold)
+            continue;
+
+        NntpCon *con = _idleConnection(&it.key()->srvParams(), straggler->ageDays);
+        if (!con)
+            continue; // nobody is idle (within the retention of the Article)
+
+        _hedges.insert(_hedgeKey(*straggler), {2, false});
+        ++_nbHedges;
+        con->hedge({straggler->msgId, straggler->job, 0, true, straggler->ageDays});
+    }
+}
+
+bool NntpScheduler::firstReply(const ScheduledArticle &article)
+{
+    auto it = _hedges.find(_hedgeKey(article));
+    if (it == _hedges.end())
+        return true;
+
+    bool first = !it->answered;
+    if (first && article.hedge)
+        ++_nbHedgeWins;
+    it->answered = true;
+    if (--it->nbCopies == 0)
+        _hedges.erase(it);
+    return first;
+}
+
+bool NntpScheduler::releaseHedged(const ScheduledArticle &article)
+{
+    auto it = _hedges.find(_hedgeKey(article));
+    if (it == _hedges.end())
+        return false;
+
+    bool lastUnanswered = --it->nbCopies == 0 && !it->answered;
+    if (it->nbCopies == 0)
+        _hedges.erase(it);
+    return !lastUnanswered;
+}
+
+void NntpScheduler::releaseJob(const NzbJob *job)
+{
+    // kept until their last copy replies or is lost: its job pointer is dangling, only the key can match it
+    for (auto it = _hedges.begin(), itEnd = _hedges.end(); it != itEnd; ++it)
+    {
+        if (it.key().first == job)
+            it->answered = true;
+    }
+}
+
+double NntpScheduler::_percentile(double percentile) const
+{
+    QVector<double> samples = _samples;
+    samples.resize(std::min(_nbSamples, static_cast<int>(sNbSamples)));
+    auto nth = samples.begin() + static_cast<int>(percentile * (samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+NntpCon *NntpScheduler::_idleConnection(const NntpServerParams *slowServer, int ageDays) const
+{
+    // another server if possible (in matrix mode the job belongs to the server)
+    // never one that doesn't keep posts that old: its 430 would win the race
+    NntpCon *sameServer = nullptr;
+    for (auto it = _conLatencies.cbegin(), itEnd = _conLatencies.cend(); it != itEnd; ++it)
+    {
+        NntpCon *con = it.key();
+        if (!con->isIdle() || !con->srvParams().covers(ageDays))
+            continue;
+        if (&con->srvParams() == slowServer)
+            sameServer = con;
+        else if (!_nzbCheck->matrixMode())
+            return con;
+    }
+    return sameServer;
+}
+
+QString NntpScheduler::stats() const
+{
+    QString stats;
+    for (auto it = _srvLatencies.cbegin(), itEnd = _srvLatencies.cend(); it != itEnd; ++it)
+        stats += QString("%1: STAT latency %2 ms (EWMA) on %3 replies\n").arg(
+                     it.key()->host).arg(it.value().ewma, 0, 'f', 1).arg(it.value().nbReplies);
+    stats += QString("%1 Article(s) stolen from slower connections").arg(_nbStolen);
+    if (_maxHedges > 0)
+        stats += QString("\n%1/%2 STAT hedged (p%3: %4 ms), %5 answered first by the hedge").arg(
+                     _nbHedges).arg(_maxHedges).arg(qRound(100 * sHedgePercentile)).arg(
+                     _nbSamples ? _percentile(sHedgePercentile) : 0., 0, 'f', 1).arg(_nbHedgeWins);
+    return stats;
+}
+
+int NntpScheduler::_batchSize(NntpCon *con) const
+{
+    const Latency &latency = _conLatencies[con];
+    if (latency.nbReplies == 0 || latency.ewma <= 0.)
+        return 1;
+
+    // replies per sBatchDuration with _pipelineDepth STAT in flight
+    int batch = qRound(_pipelineDepth * sBatchDuration / latency.ewma);
+    return qBound(1, batch, static_cast<int>(sMaxBatch));
+}
+
+void NntpScheduler::_steal(NntpCon *thief, QQueue<ScheduledArticle> &unsent)
+{
+    // tail of the run: leave it to the fastest servers
+    const Latency &thiefSrv = _srvLatencies[&thief->srvParams()];
+    double bestSrvLatency = 0.;
+    for (const Latency &srvLatency : _srvLatencies)
+    {
+        if (srvLatency.nbReplies && (bestSrvLatency == 0. || srvLatency.ewma < bestSrvLatency))
+            bestSrvLatency = srvLatency.ewma;
+    }
+    // in matrix mode each server has to check all the Articles (jobs are per server)
+    bool sameServerOnly = _nzbCheck->matrixMode();
+    if (!sameServerOnly && thiefSrv.nbReplies && thiefSrv.ewma > sTailSlowFactor * bestSrvLatency)
+        return;
+
+    // the victim is the connection that would take the longest to send its unsent Articles
+    // (only the ones within the retention of the thief's server count)
+    const Latency &thiefLatency = _conLatencies[thief];
+    NntpCon *victim          = nullptr;
+    double   victimDrain     = 0.;
+    int      victimStealable = 0;
+    for (auto it = _conLatencies.cbegin(), itEnd = _conLatencies.cend(); it != itEnd; ++it)
+    {
+        NntpCon *con = it.key();
+        if (con == thief || con->nbUnsent() == 0)
+            continue;
+        if (sameServerOnly && &con->srvParams() != &thief->srvParams())
+            continue;
+        int nbStealable = con->nbUnsentFor(thief->srvParams());
+        if (nbStealable == 0)
+            continue;
+        if (thiefLatency.nbReplies && it.value().nbReplies && it.value().ewma <= thiefLatency.ewma && nbStealable < 2)
+            continue; // not slower than us and almost done
+        double drain = nbStealable * (it.value().nbReplies ? it.value().ewma : bestSrvLatency + 1.);
+        if (drain > victimDrain)
+        {
+            victim          = con;
+            victimDrain     = drain;
+            victimStealable = nbStealable;
+        }
+    }
+
+    if (victim)
+    {
+        int nbBefore = unsent.size();
+        victim->giveUnsent((victimStealable + 1) / 2, unsent, thief->srvParams());
+        _nbStolen += unsent.size() - nbBefore;
+    }
+}
@@ -0,0 +1,140 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NNTPSCHEDULER_H
+#define NNTPSCHEDULER_H
+
+#include <QString>
+#include <QQueue>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <QElapsedTimer>
+class NzbCheck;
+class NntpCon;
+struct NzbJob;
+struct NntpServerParams;
+
+struct ScheduledArticle
+{
+    QString msgId;
+    NzbJob *job;
+    qint64  sentTime; //!< ns on the scheduler clock when the STAT was sent
+    bool    hedge;    //!< duplicate of a straggler sent on another connection
+    int     ageDays;  //!< aged Article (NzbJob::articleAges): only for the servers covering it, 0 for any
+};
+
+/*!
+ * \brief hands the Articles to the connections by batches
+ * - the latency of each connection and each server is tracked with an EWMA
+ * - fast connections get bigger batches (sized to sBatchDuration of work)
+ * - an idle connection steals the unsent Articles of the slowest one
+ * - the aged Articles only move to a connection whose server covers them (retention), stolen or hedged
+ * - at the end of the run, the servers much slower than the fastest one don't take more work
+ * - hedging (optional): a STAT waiting longer than the p95 latency is sent again on an idle connection
+ *   (another server if possible), the first reply is used, within a budget of duplicates
+ */
+class NntpScheduler
+{
+public:
+    NntpScheduler(NzbCheck *nzbCheck, int pipelineDepth);
+
+    NntpScheduler(const NntpScheduler &other) = delete;
+    NntpScheduler & operator=(const NntpScheduler &other) = delete;
+
+    void addConnection(NntpCon *con);
+    void removeConnection(NntpCon *con);
+
+    //! fill the (empty) unsent queue of con
+    void refill(NntpCon *con, QQueue<ScheduledArticle> &unsent);
+
+    //! con received the reply of a STAT sent latency ns ago
+    void replied(NntpCon *con, qint64 latency);
+
+    QString stats() const;
+
+    //! allow up to maxHedges duplicate STAT
+    inline void setHedging(int maxHedges);
+    inline bool canHedge() const;
+    //! send the stragglers again on idle connections (called periodically)
+    void hedgeStragglers();
+    //! a reply for article: false if it's the second reply of a hedged STAT (to be discarded)
+    bool firstReply(const ScheduledArticle &article);
+    //! the connection of article is lost: false if it must be given back (not hedged or last copy unanswered)
+    bool releaseHedged(const ScheduledArticle &article);
+    //! the job is finished: the copies of its hedges still in flight are discarded when they reply
+    void releaseJob(const NzbJob *job);
+
+    inline qint64 now() const;
+    inline int pipelineDepth() const;
+
+private:
+    struct Latency {
+        double ewma;      //!< ms
+        int    nbReplies;
+
+        Latency() : ewma(0.), nbReplies(0) {}
+        void add(double latency);
+    };
+
+    NzbCheck *const                          _nzbCheck;
+    const int                                _pipelineDepth; //!< STAT in flight per connection
+    QElapsedTimer                            _clock;
+    QHash<NntpCon*, Latency>                 _conLatencies;
+    QHash<const NntpServerParams*, Latency>  _srvLatencies;
+    int                                      _nbStolen;      //!< Articles moved from a connection to another
+
+    struct Hedge {
+        int  nbCopies; //!< STAT in flight for the Article
+        bool answered;
+    };
+    QVector<double>                          _samples;       //!< last STAT latencies (ms), ring buffer for the percentile
+    int                                      _nbSamples;
+    typedef QPair<const NzbJob*, QString> HedgeKey;       //!< the same Article is checked once per job (--matrix: per server)
+    QHash<HedgeKey, Hedge>                   _hedges;
+    int                                      _maxHedges;
+    int                                      _nbHedges;
+    int                                      _nbHedgeWins;   //!< hedges that replied first
+
+    static const int    sBatchDuration  = 200; //!< ms of work given in one batch
+    static const int    sMaxBatch       = 64;
+    static const int    sTailSlowFactor = 3;   //!< a server this times slower than the best one doesn't take the tail
+    static const double sAlpha;                //!< EWMA weight of a new sample
+    static const int    sNbSamples       = 1024; //!< latencies kept for the percentile
+    static const int    sMinHedgeSamples = 32;   //!< replies before hedging
+    static const double sHedgePercentile;       //!< a STAT slower than this percentile is hedged
+
+    double _percentile(double percentile) const;
+    NntpCon *_idleConnection(const NntpServerParams *slowServer, int ageDays) const;
+
+    static inline HedgeKey _hedgeKey(const ScheduledArticle &article);
+
+    int _batchSize(NntpCon *con) const;
+    void _steal(NntpCon *thief, QQueue<ScheduledArticle> &unsent);
+};
+
+qint64 NntpScheduler::now() const { return _clock.nsecsElapsed(); }
+int NntpScheduler::pipelineDepth() const { return _pipelineDepth; }
+void NntpScheduler::setHedging(int maxHedges) { _maxHedges = maxHedges; }
+bool NntpScheduler::canHedge() const { return _nbHedges < _maxHedges; }
+NntpScheduler::HedgeKey NntpScheduler::_hedgeKey(const ScheduledArticle &article) { return qMakePair(static_cast<const NzbJob*>(article.job), article.msgId); }
+
+#endif // NNTPSCHEDULER_H
@@ -33,6 +33,9 @@ struct NntpServerParams{
     int         nbCons;
     bool        useSSL;
     bool        enabled;
+    int         retention; //!< in days, 0 for unlimited
+
+    static const int sSecondsPerDay = 86400;
 
     static const ushort sDefaultPort = 119;
     static const ushort sDefaultSslPort = 563;
@@ -40,14 +43,14 @@ struct NntpServerParams{
 
     NntpServerParams():
         host(""), port(sDefaultPort), auth(false), user(""),
-        pass(""), nbCons(1), useSSL(false), enabled(true)
+        pass(""), nbCons(1), useSSL(false), enabled(true), retention(0)
     {}
 
     NntpServerParams(const QString & aHost, ushort aPort = sDefaultPort, bool aAuth = false,
                          const std::string &aUser = "", const std::string &aPass = "",
-                         int aNbCons = 1, bool aUseSSL = false):
+                         int aNbCons = 1, bool aUseSSL = false, int aRetention = 0):
        host(aHost), port(aPort), auth(aAuth), user(aUser),
-       pass(aPass), nbCons(aNbCons), useSSL(aUseSSL), enabled(true)
+       pass(aPass), nbCons(aNbCons), useSSL(aUseSSL), enabled(true), retention(aRetention)
     {}
 
     ~NntpServerParams() = default;
@@ -56,8 +59,11 @@ struct NntpServerParams{
     NntpServerParams(NntpServerParams&& aParams) = default;
 
     inline QString str() const;
+    inline bool covers(int ageDays) const; //!< a post of that age is still within the retention
 };
 
+bool NntpServerParams::covers(int ageDays) const { return retention == 0 || ageDays <= retention; }
+
 
 QString NntpServerParams::str() const
 {
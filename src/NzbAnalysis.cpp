@@ -0,0 +1,89 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbAnalysis.h"
+#include "NzbParser.h"
+#include <QFile>
+#include <QSet>
+
+NzbAnalysis::NzbAnalysis():
+    nzbPath(), error(),
+    nbFiles(0), nbSegments(0), nbExpectedSegments(0), nbMissingSegments(0),
+    nbDuplicateSegments(0), nbZeroByteSegments(0), hasPar2(false),
+    incompleteFiles()
+{}
+
+NzbAnalysis NzbAnalysis::analyse(const QString &nzbPath)
+{
+    NzbAnalysis analysis;
+    analysis.nzbPath = nzbPath;
+
+    QFile file(nzbPath);
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        analysis.error = QString("Error opening nzb file...");
+        return analysis;
+    }
+
+    QVector<NzbFile> nzbFiles;
+    if (!NzbParser::parse(&file, nzbFiles, analysis.error))
+        return analysis;
+
+    QSet<QString> msgIds;
+    analysis.nbFiles = nzbFiles.size();
+    for (const NzbFile &nzbFile : nzbFiles)
+    {
+        int nbArticles = nzbFile.segments.size();
+        analysis.nbSegments         += nbArticles;
+        analysis.nbExpectedSegments += nzbFile.nbExpectedSegments;
+        if (nbArticles < nzbFile.nbExpectedSegments)
+        {
+            analysis.nbMissingSegments += nzbFile.nbExpectedSegments - nbArticles;
+            analysis.incompleteFiles << QString("%1 (%2/%3)").arg(
+                                            nzbFile.subject).arg(nbArticles).arg(nzbFile.nbExpectedSegments);
+        }
+
+        if (nzbFile.subject.contains(".par2", Qt::CaseInsensitive))
+            analysis.hasPar2 = true;
+
+        QSet<int> numbers;
+        for (const NzbSegment &segment : nzbFile.segments)
+        {
+            if (msgIds.contains(segment.msgId))
+                ++analysis.nbDuplicateSegments;
+            else
+            {
+                msgIds.insert(segment.msgId);
+                if (segment.number > 0)
+                {
+                    if (numbers.contains(segment.number))
+                        ++analysis.nbDuplicateSegments;
+                    else
+                        numbers.insert(segment.number);
+                }
+            }
+
+            if (segment.bytes == 0)
+                ++analysis.nbZeroByteSegments;
+        }
+    }
+    return analysis;
+}
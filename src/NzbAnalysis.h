@@ -0,0 +1,58 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NZBANALYSIS_H
+#define NZBANALYSIS_H
+
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief structural analysis of an nzb (no network involved)
+ * analyse() is reentrant so several nzbs can be analysed in parallel
+ */
+struct NzbAnalysis
+{
+    QString     nzbPath;
+    QString     error;               //!< parsing error (empty if the nzb could be parsed)
+    int         nbFiles;
+    int         nbSegments;          //!< segments present in the nzb
+    int         nbExpectedSegments;  //!< segments expected from the yEnc subjects
+    int         nbMissingSegments;   //!< segments expected but not present in the nzb
+    int         nbDuplicateSegments; //!< same message-id or same segment number used twice
+    int         nbZeroByteSegments;  //!< segments with bytes="0"
+    bool        hasPar2;
+    QStringList incompleteFiles;     //!< "<subject> (present/expected)"
+
+    NzbAnalysis();
+
+    inline bool isHealthy() const;
+
+    static NzbAnalysis analyse(const QString &nzbPath);
+};
+
+bool NzbAnalysis::isHealthy() const
+{
+    return error.isEmpty() && nbMissingSegments == 0 && nbDuplicateSegments == 0
+            && nbZeroByteSegments == 0 && hasPar2;
+}
+
+#endif // NZBANALYSIS_H
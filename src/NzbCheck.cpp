@@ -22,17 +22,46 @@
 #include "NzbCheck.h"
 #include "NntpCon.h"
 #include "NntpServerParams.h"
+#include "NzbParser.h"
+#include "NzbAnalysis.h"
+#include "TraceRecorder.h"
+#include "NzbWatcher.h"
+#include "NntpScheduler.h"
+#include "SessionRecorder.h"
+#include "SessionReplay.h"
+#include "NntpCompression.h"
+#include "MemoryStats.h"
+#include "ConnectionLedger.h"
+#include "ShardCoordinator.h"
+#include "ShardWorker.h"
+#include "Checkpoint.h"
+#include "ResultFile.h"
+#include "ConnectionBroker.h"
+#include "BrokerClient.h"
 #include <cmath>
+#include <algorithm>
 
 #include <QFile>
 #include <QFileInfo>
-#include <QXmlStreamReader>
+#include <QDir>
+#include <QtConcurrent>
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QRegularExpression>
 #include <QTime>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMetaMethod>
+#include <QtAlgorithms>
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
 
-const QRegularExpression NzbCheck::sNntpArticleYencSubjectRegExp = QRegularExpression(sNntpArticleYencSubjectStrRegExp);
+const double NzbCheck::sHeadBytesTolerance = 0.02;
+const double NzbCheck::sHeadLinesTolerance = 0.1;
+const QRegularExpression NzbCheck::sSubjectPartRegExp = QRegularExpression("\\((\\d+)/(\\d+)\\)\\s*$");
 
 const QMap<NzbCheck::Opt, QString> NzbCheck::sOptionNames =
 {
@@ -41,6 +70,31 @@ const QMap<NzbCheck::Opt, QString> NzbCheck::sOptionNames =
     {Opt::PROGRESS,    "progress"},
     {Opt::DEBUG,       "debug"},
     {Opt::QUIET,       "quit"},
+    {Opt::OFFLINE,     "offline"},
+    {Opt::MATRIX,      "matrix"},
+    {Opt::TRACE,       "trace"},
+    {Opt::MEMSTATS,    "memstats"},
+    {Opt::RECORD,      "record"},
+    {Opt::REPLAY,      "replay"},
+    {Opt::REPLAY_SPEED, "replay-speed"},
+    {Opt::RESULT,      "result"},
+    {Opt::RESULT_FORMAT, "result-format"},
+    {Opt::PREVIOUS,    "previous"},
+    {Opt::ROTATE,      "rotate"},
+    {Opt::CHECKPOINT,  "checkpoint"},
+    {Opt::WATCH,       "watch"},
+    {Opt::JOBS,        "jobs"},
+    {Opt::COORDINATOR, "coordinator"},
+    {Opt::WORKER,      "worker"},
+    {Opt::DEADLINE,    "deadline"},
+    {Opt::PIPELINE,    "pipeline"},
+    {Opt::HEDGE,       "hedge"},
+    {Opt::COMPRESS,    "compress"},
+    {Opt::HEAD,        "head"},
+    {Opt::SHARED_CONS, "shared-cons"},
+    {Opt::TLS_RESUME,  "tls-resume"},
+    {Opt::BROKER,      "broker"},
+    {Opt::USE_BROKER,  "use-broker"},
     {Opt::INPUT,       "input"},
     {Opt::SERVER,      "server"},
     {Opt::HOST,        "host"},
@@ -57,48 +111,463 @@ const QList<QCommandLineOption> NzbCheck::sCmdOptions = {
     { sOptionNames[Opt::PROGRESS],            tr( "display progress bar")},
     {{"d", sOptionNames[Opt::DEBUG]},         tr( "display debug information")},
     {{"q", sOptionNames[Opt::QUIET]},         tr( "quiet mode (no output on stdout)")},
+    { sOptionNames[Opt::OFFLINE],             tr( "offline mode: only analyse the structure of the nzb(s) (input can be a folder)")},
+    { sOptionNames[Opt::MATRIX],              tr( "check all the Articles on each server and display which server has what (input can be a folder)")},
+    { sOptionNames[Opt::TRACE],               tr( "write a timeline of the run in Chrome trace-event format (Perfetto)"), sOptionNames[Opt::TRACE]},
+    { sOptionNames[Opt::MEMSTATS],            tr( "count the allocations per stage (parse, queue, connections, output) and report them with the peak memory at exit")},
+    { sOptionNames[Opt::RECORD],              tr( "record the exchanges of all the connections in a file (to be replayed, no credentials)"), sOptionNames[Opt::RECORD]},
+    { sOptionNames[Opt::REPLAY],              tr( "replay a recorded session instead of connecting to the servers"), sOptionNames[Opt::REPLAY]},
+    { sOptionNames[Opt::REPLAY_SPEED],        tr( "speed factor of the replay (default: 1, 0 for no delay)"), "speed"},
     {{"i", sOptionNames[Opt::INPUT]},         tr( "input file : nzb file to check"), sOptionNames[Opt::INPUT]},
+    {{"r", sOptionNames[Opt::RESULT]},        tr( "write the result in a json file"), sOptionNames[Opt::RESULT]},
+    { sOptionNames[Opt::RESULT_FORMAT],       tr( "json (default) or bin: ranges of missing segments per file (read it with nzbResult or ResultFile)"), "format"},
+    { sOptionNames[Opt::PREVIOUS],            tr( "json result of a previous run: only recheck the Articles that were present"), sOptionNames[Opt::PREVIOUS]},
+    { sOptionNames[Opt::ROTATE],              tr( "with --previous, only recheck 1/N of the present Articles (a different slice each run)"), sOptionNames[Opt::ROTATE]},
+    { sOptionNames[Opt::CHECKPOINT],          tr( "save the progress in a file: a killed check started again with the same nzb only checks what is left"), sOptionNames[Opt::CHECKPOINT]},
+    {{"w", sOptionNames[Opt::WATCH]},         tr( "watch a folder: check each new nzb and write its json result next to it"), sOptionNames[Opt::WATCH]},
+    {{"j", sOptionNames[Opt::JOBS]},          tr( "number of nzbs checked concurrently in watch mode (default: 2)"), sOptionNames[Opt::JOBS]},
+    { sOptionNames[Opt::COORDINATOR],         tr( "parse the nzb and hand its Articles to the workers connecting on that port (no server needed)"), "port"},
+    { sOptionNames[Opt::WORKER],              tr( "check the Articles given by a coordinator (<host>:<port>) with the servers of the command line"), "coordinator"},
+    { sOptionNames[Opt::HEAD],                tr( "HEAD instead of STAT: check the size and part number of each Article against the nzb")},
+    { sOptionNames[Opt::DEADLINE],            tr( "give the best answer within a time budget (ex: 3s, 500ms): files sampled evenly, partial result"), "duration"},
 
-    {{"S", sOptionNames[Opt::SERVER]},        tr("NNTP server following the format (<user>:<pass>@@@)?<host>:<port>:<nbCons>:(no)?ssl"), sOptionNames[Opt::SERVER]},
+    {{"S", sOptionNames[Opt::SERVER]},        tr("NNTP server following the format (<user>:<pass>@@@)?<host>:<port>:<nbCons>:(no)?ssl(:<retention>d)?"), sOptionNames[Opt::SERVER]},
     {{"h", sOptionNames[Opt::HOST]},          tr("NNTP server hostname (or IP)"), sOptionNames[Opt::HOST]},
     {{"P", sOptionNames[Opt::PORT]},          tr("NNTP server port"), sOptionNames[Opt::PORT]},
     {{"s", sOptionNames[Opt::SSL]},           tr("use SSL")},
     {{"u", sOptionNames[Opt::USER]},          tr("NNTP server username"), sOptionNames[Opt::USER]},
     {{"p", sOptionNames[Opt::PASS]},          tr("NNTP server password"), sOptionNames[Opt::PASS]},
-    {{"n", sOptionNames[Opt::CONNECTION]},    tr("number of NNTP connections"), sOptionNames[Opt::CONNECTION]}
+    {{"n", sOptionNames[Opt::CONNECTION]},    tr("number of NNTP connections"), sOptionNames[Opt::CONNECTION]},
+    { sOptionNames[Opt::PIPELINE],            tr("number of STAT sent in a row on each connection (default: 1)"), sOptionNames[Opt::PIPELINE]},
+    { sOptionNames[Opt::HEDGE],               tr("resend the STAT slower than the p95 on an idle connection, max N% of duplicates"), "N"},
+    { sOptionNames[Opt::COMPRESS],            tr("use NNTP compression (COMPRESS DEFLATE) when the server supports it")},
+    { sOptionNames[Opt::SHARED_CONS],         tr("the number of connections is the limit of the account, shared with the other nzbcheck running on the host")},
+    { sOptionNames[Opt::TLS_RESUME],          tr("SSL: the connections resume the TLS session of the first one (no full handshake), CPU usage given in the summary")},
+    { sOptionNames[Opt::BROKER],              tr("keep the connections open and lend them to the nzbcheck of the host using --use-broker (no nzb needed)"), "name"},
+    { sOptionNames[Opt::USE_BROKER],          tr("borrow authenticated connections from a broker instead of opening ours (the servers become optional)"), "name"}
 };
 
 void NzbCheck::onDisconnected(NntpCon *con)
 {
     _connections.remove(con);
+    _scheduler->removeConnection(con);
+    _borrowed.remove(con); // lost: the broker reopens it when we give back the others
+    ConnectionLedger *ledger = _ledgers.value(&con->srvParams(), nullptr);
+    int delay = (_poolMode || ledger) && !_finished ? _reconnectDelay(con) : -1;
+    if (ledger)
+    {
+        ledger->release(con->id() - 1); // another process can take it
+        // we lease it again (onLedgerTimer) right away if it was a good one, after the backoff if its login failed
+        _reconnects[&con->srvParams()].notBefore = con->loggedIn() || delay < 0 ?
+                    0 : QDateTime::currentMSecsSinceEpoch() + delay;
+    }
+    _startDeferredConnections(con->srvParams()); // the first connection failed before giving its session
+    if (_poolMode && !_finished)
+    {
+        // keep the pool warm: reopen the lost connection
+        const NntpServerParams &srvParams = con->srvParams();
+        int id = con->id();
+        if (debugMode() && delay >= 0)
+            _cout << tr("[Con #%1] Reopened in %2 ms").arg(id).arg(delay) << "\n" << MB_FLUSH;
+        con->deleteLater();
+        if (delay >= 0)
+        {
+            QTimer::singleShot(delay, this, [this, &srvParams, id](){
+                _startConnections(srvParams, QList<int>() << id, sPoolTraceCapacity);
+            });
+        }
+    }
+    else if (_connections.isEmpty())
+    {
+        if (_finished)
+            _quit();
+        else
+            _finishCheck(); // some Articles couldn't be checked
+    }
+}
+
+int NzbCheck::_reconnectDelay(const NntpCon *con)
+{
+    Reconnect &reconnect = _reconnects[&con->srvParams()];
+    if (con->authRefused() && !reconnect.authRefused)
+    {
+        reconnect.authRefused = true;
+        _cerr << tr("Authentication refused by %1: its connections won't be reopened").arg(
+                     con->srvParams().host) << "\n" << MB_FLUSH;
+    }
+    if (reconnect.authRefused)
+        return -1;
+
+    // the server took us: it was a one-off, otherwise back off while it doesn't
+    if (con->loggedIn() || reconnect.delay == 0)
+        reconnect.delay = sReconnectDelay;
+    else
+        reconnect.delay = 2 * reconnect.delay < sMaxReconnectDelay ? 2 * reconnect.delay : sMaxReconnectDelay;
+    return reconnect.delay;
+}
+
+void NzbCheck::onNzbReady(const QString &nzbPath)
+{
+    for (NzbJob *job : _pendingJobs + _jobs)
+    {
+        if (job->nzbPath == nzbPath)
+            return;
+    }
+
+    if (debugMode())
+        _cout << tr("New nzb to check: %1").arg(nzbPath) << "\n" << MB_FLUSH;
+    checkNzb(nzbPath, _resultPathNextTo(nzbPath));
+}
+
+void NzbCheck::onStopDispatch()
+{
+    if (debugMode())
+        _cout << tr("Deadline close: stop sending STAT, waiting for the replies in flight") << "\n" << MB_FLUSH;
+    _dispatchStopped = true;
+    for (NntpCon *con : _connections)
+        con->dropUnsent();
+}
+
+void NzbCheck::onDeadline()
+{
+    if (!_finished)
+        _finishCheck(); // don't wait for the last replies or the connections to close
+}
+
+void NzbCheck::_finishCheck()
+{
+    if (_finished)
+        return;
+    _finished = true;
+
+    if (_matrixMode)
+    {
+        _printMatrix();
+        if (debugMode() && _scheduler)
+            _cout << _scheduler->stats() << "\n" << MB_FLUSH;
+        _shutdown();
+        return;
+    }
+
+    NzbJob *job = _jobs.first();
+    _nbMissingArticles = job->nbMissingArticles;
+    if (_dispProgressBar)
+    {
+        disconnect(&_progressbarTimer, &QTimer::timeout, this, &NzbCheck::onRefreshprogressbarBar);
+        onRefreshprogressbarBar();
+        _cout << "\n" << MB_FLUSH;
+    }
+
+    if (!_quietMode)
+        _printSummary(job);
+    if (debugMode() && _scheduler)
+        _cout << _scheduler->stats() << "\n" << MB_FLUSH;
+    if (!job->resultPath.isEmpty())
+        _writeResult(job);
+    if (_checkpoint)
+    {
+        _checkpointTimer.stop();
+        if (job->nbCheckedArticles == job->nbTotalArticles)
+            _checkpoint->remove(); // complete: the next run starts from scratch
+        else
+            _checkpoint->flush();  // --deadline or lost connections: the next run finishes it
+    }
+    _emitResults(job);
+    _shutdown();
+}
+
+void NzbCheck::_startHedging(int nbArticles)
+{
+    if (_hedgeBudget <= 0.)
+        return;
+
+    _scheduler->setHedging(std::max(1, static_cast<int>(std::ceil(_hedgeBudget * nbArticles / 100))));
+    connect(&_hedgeTimer, &QTimer::timeout, this, &NzbCheck::onHedgeTimer);
+    _hedgeTimer.start(sHedgePeriod);
+}
+
+void NzbCheck::_leaseConnections(int traceCapacity)
+{
+    // no more connections than Articles still to give
+    int nbWanted = _jobs.first()->nbQueuedArticles();
+    for (NntpServerParams *srvParams : _nntpServers)
+    {
+        ConnectionLedger *ledger = _ledgers.value(srvParams, nullptr);
+        if (!ledger)
+        {
+            ledger = new ConnectionLedger(*srvParams);
+            _ledgers.insert(srvParams, ledger);
+            if (ledger->nbSlots() != srvParams->nbCons && !_quietMode)
+                _cout << tr("%1: limit of %2 connection(s) set by the first nzbcheck of the account").arg(
+                             srvParams->host).arg(ledger->nbSlots()) << "\n" << MB_FLUSH;
+        }
+        const Reconnect reconnect = _reconnects.value(srvParams);
+        if (reconnect.authRefused || QDateTime::currentMSecsSinceEpoch() < reconnect.notBefore)
+            continue; // its logins fail: backing off
+        QList<int> ids;
+        for (int slot : ledger->lease(nbWanted))
+            ids << slot + 1; // the connection id is the slot
+        nbWanted -= ids.size();
+        _startConnections(*srvParams, ids, traceCapacity); // --tls-resume: behind the first one of the server
+    }
+    int nbCons = _connections.size();
+    for (const DeferredCons &deferred : _deferredCons)
+        nbCons += deferred.ids.size();
+    if (debugMode())
+        _cout << tr("Connection slots leased: %1").arg(nbCons) << "\n" << MB_FLUSH;
+    _nbCons = std::max(_nbCons, nbCons);
+}
+
+void NzbCheck::onLedgerTimer()
+{
+    if (_dispatchStopped || _finished || _jobs.first()->nbQueuedArticles() == 0)
+        return;
+    _leaseConnections(sPoolTraceCapacity);
+}
+
+void NzbCheck::onHedgeTimer()
+{
+    _scheduler->hedgeStragglers();
+}
+
+void NzbCheck::_shutdown()
+{
+    _hedgeTimer.stop();
+    _ledgerTimer.stop();
+    // the result is given: QUIT on all the connections at once, nothing blocks
+    _teardownClock.start();
+    if (_brokerClient)
+        _giveBackConnections();
     if (_connections.isEmpty())
     {
-        if (_dispProgressBar)
+        _quit();
+        return;
+    }
+    for (NntpCon *con : _connections)
+        emit con->killConnection();
+    QTimer::singleShot(sShutdownTimeout, this, &NzbCheck::onShutdownTimeout);
+}
+
+void NzbCheck::onShutdownTimeout()
+{
+    if (!_teardownClock.isValid())
+        return; // all closed already
+    if (!_quietMode)
+        _cout << tr("%1 connection(s) still closing after %2 ms, we don't wait for them").arg(
+                     _connections.size()).arg(sShutdownTimeout) << "\n" << MB_FLUSH;
+    _quit();
+}
+
+void NzbCheck::_quit()
+{
+    if (!_teardownClock.isValid())
+        return;
+    if (!_quietMode)
+        _cout << tr("Connections closed in %1 ms").arg(_teardownClock.elapsed()) << "\n" << MB_FLUSH;
+    _teardownClock.invalidate();
+    if (MemoryStats::isEnabled())
+        _printMemoryStats();
+    qApp->quit();
+}
+
+void NzbCheck::_finishJob(NzbJob *job)
+{
+    _jobs.removeOne(job);
+    _nbMissingArticles += job->nbMissingArticles;
+    _nbRunArticles     += job->nbTotalArticles;
+    _nbRunChecked      += job->nbCheckedArticles - job->nbCarriedArticles;
+    if (!_quietMode)
+        _printSummary(job);
+    if (!job->resultPath.isEmpty())
+        _writeResult(job);
+    _emitResults(job);
+    if (_scheduler)
+        _scheduler->releaseJob(job);
+    delete job;
+
+    _startPendingJobs();
+}
+
+void NzbCheck::_emitResults(NzbJob *job)
+{
+    MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+    if (isSignalConnected(QMetaMethod::fromSignal(&NzbCheck::fileResult)))
+    {
+        QSet<QString> missingArticles;
+        missingArticles.reserve(job->missingArticles.size());
+        for (const QString &article : job->missingArticles)
+            missingArticles.insert(article);
+
+        for (const NzbFile &nzbFile : job->files)
         {
-            disconnect(&_progressbarTimer, &QTimer::timeout, this, &NzbCheck::onRefreshprogressbarBar);
-            onRefreshprogressbarBar();
-            _cout << "\n" << MB_FLUSH;
+            int nbArticles = nzbFile.segments.size();
+            int nbMissing  = std::max(0, nzbFile.nbExpectedSegments - nbArticles);
+            for (const NzbSegment &segment : nzbFile.segments)
+            {
+                if (missingArticles.contains(segment.msgId))
+                    ++nbMissing;
+            }
+            emit fileResult(job->id, nzbFile.subject, nbArticles, nbMissing);
         }
+    }
+    emit jobFinished(job->id, job->nbTotalArticles, job->nbMissingArticles);
+}
 
-        if (!_quietMode)
+void NzbCheck::_startPendingJobs()
+{
+    bool newArticles = false;
+    while (_jobs.size() < _nbJobsInFlight && !_pendingJobs.isEmpty())
+    {
+        NzbJob *job = _pendingJobs.takeFirst();
+        job->timeStart.start();
+        int nbArticles = job->parsed ? _addArticles(job) : _parseNzb(job);
+        if (nbArticles < 0)
+        {
+            emit jobError(job->id, tr("Error parsing nzb %1").arg(job->nzbPath));
+            delete job;
+        }
+        else
         {
-            qint64 duration = _timeStart.elapsed();
-            _cout << tr("Nb Missing Article(s): %1/%2 (check done in %3 (%4 sec) using %5 connections on %6 server(s))").arg(
-                         _nbMissingArticles).arg(
-                         _nbTotalArticles).arg(
-                         QTime::fromMSecsSinceStartOfDay(static_cast<int>(duration)).toString("hh:mm:ss.zzz")).arg(
-                         std::round(1.*duration/1000)).arg(
-                         _nbCons).arg(
-                         _nntpServers.size()) << "\n" << MB_FLUSH;
+            _jobs << job;
+            if (job->isDone())
+                _finishJob(job); // empty nzb
+            else
+                newArticles = true;
         }
-        qApp->quit();
     }
+
+    if (newArticles)
+    {
+        for (NntpCon *con : _connections)
+            emit con->wakeUp();
+    }
+}
+
+void NzbCheck::_printSummary(NzbJob *job)
+{
+    MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+    qint64 duration = job->timeStart.elapsed();
+    _cout << (_poolMode ? QString("%1: ").arg(job->name()) : QString())
+          << tr("Nb Missing Article(s): %1/%2 (check done in %3 (%4 sec) using %5 connections on %6 server(s))").arg(
+                 job->nbMissingArticles).arg(
+                 job->nbTotalArticles).arg(
+                 QTime::fromMSecsSinceStartOfDay(static_cast<int>(duration)).toString("hh:mm:ss.zzz")).arg(
+                 std::round(1.*duration/1000)).arg(
+                 _nbCons).arg(
+                 _nntpServers.size()) << "\n" << MB_FLUSH;
+    if (_deadline > 0)
+        _cout << tr("Deadline %1 ms: %2/%3 Article(s) checked (%4), estimated completeness: %5%").arg(
+                     _deadline).arg(
+                     job->nbCheckedArticles).arg(
+                     job->nbTotalArticles).arg(
+                     job->nbCheckedArticles == job->nbTotalArticles ? tr("exhaustive") : tr("partial")).arg(
+                     100. * _estimatedCompleteness(job), 0, 'f', 2) << "\n" << MB_FLUSH;
+    if (!_previousPath.isEmpty())
+        _cout << tr("%1 Article(s) carried over from the previous result, %2 newly missing").arg(
+                     job->nbCarriedArticles).arg(
+                     job->nbMissingArticles - job->nbMissingInNzb - job->nbCarriedMissing
+                     - job->nbExpiredPreviouslyMissing) << "\n" << MB_FLUSH; // like newlyMissing in the json result
+    if (job->nbExpiredArticles > 0)
+        _cout << tr("%1 Article(s) beyond the retention of the servers (missing without STAT)").arg(
+                     job->nbExpiredArticles) << "\n" << MB_FLUSH;
+    if (_headMode)
+        _cout << tr("Nb Mismatched Article(s): %1/%2 (present but not matching the nzb)").arg(
+                     job->nbMismatchArticles).arg(
+                     job->nbTotalArticles) << "\n" << MB_FLUSH;
+    if (_compress && !_poolMode)
+        _printCompression();
+    qint64 cpuTime = _cpuTimeMs(), nbChecked = job->nbCheckedArticles - job->nbCarriedArticles - job->nbExpiredArticles;
+    if ((_tlsResume || debugMode()) && !_poolMode && cpuTime >= 0 && nbChecked > 0)
+        _cout << tr("CPU: %1 ms (%2 ms per 1k %3)").arg(cpuTime).arg(
+                     1000. * cpuTime / nbChecked, 0, 'f', 1).arg(_headMode ? "HEAD" : "STAT") << "\n" << MB_FLUSH;
+}
+
+qint64 NzbCheck::_cpuTimeMs()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return 1000 * static_cast<qint64>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+void NzbCheck::addCompressionStats(const NntpCompression &compression)
+{
+    _nbBytesReceived += compression.nbBytesReceived();
+    _nbBytesInflated += compression.nbBytesInflated();
+    _nbBytesSent     += compression.nbBytesSent();
+    _nbBytesDeflated += compression.nbBytesDeflated();
+}
+
+void NzbCheck::_printMemoryStats()
+{
+    // the finished jobs are deleted (pool, watch, worker and broker modes): the totals of the run + the jobs still there
+    qint64 nbArticles = _nbRunArticles, nbChecked = _nbRunChecked;
+    for (const NzbJob *job : _jobs)
+    {
+        nbArticles += job->nbTotalArticles;
+        nbChecked  += job->nbCheckedArticles - job->nbCarriedArticles;
+    }
+    if (_matrixMode)
+        nbArticles = _nbMatrixArticles;
+
+    qint64 peakRss = MemoryStats::peakRssKB(), nbAllocations = 0;
+    _cout << tr("Memory: peak RSS %1 KB").arg(peakRss);
+    if (peakRss > 0 && nbArticles > 0)
+        _cout << tr(", %1 bytes per Article").arg(1024. * peakRss / nbArticles, 0, 'f', 1);
+    _cout << "\n";
+    if (!MemoryStats::isHooked())
+        _cout << tr("  operator new not counted (the hook is only in the nzbcheck command line)") << "\n";
+    // the malloc heap: OTHER is what the stages don't explain (event loop, allocations before the check...)
+    qint64 heapInUse = MemoryStats::heapInUse(), otherHeap = heapInUse;
+    for (int i = 1; i < static_cast<int>(MemoryStats::Stage::NB_STAGES); ++i)
+        otherHeap -= MemoryStats::heapGrowth(static_cast<MemoryStats::Stage>(i));
+    for (int i = 0; i < static_cast<int>(MemoryStats::Stage::NB_STAGES); ++i)
+    {
+        MemoryStats::Stage stage = static_cast<MemoryStats::Stage>(i);
+        qint64 nbStageAllocations = MemoryStats::nbAllocations(stage), nbBytes = MemoryStats::nbBytes(stage);
+        nbAllocations += nbStageAllocations;
+        _cout << QString("  - %1: %2 allocations, %3 bytes").arg(
+                     MemoryStats::stageName(stage), -11).arg(nbStageAllocations).arg(nbBytes);
+        if (nbArticles > 0)
+            _cout << tr(" (%1 bytes per Article)").arg(1. * nbBytes / nbArticles, 0, 'f', 1);
+        if (heapInUse >= 0)
+            _cout << tr(", heap %1 bytes").arg(stage == MemoryStats::Stage::OTHER ? otherHeap : MemoryStats::heapGrowth(stage));
+        _cout << "\n";
+    }
+    if (nbChecked > 0 && MemoryStats::isHooked())
+        _cout << tr("%1 allocations per checked Article").arg(1. * nbAllocations / nbChecked, 0, 'f', 1) << "\n";
+    _cout << MB_FLUSH;
+}
+
+void NzbCheck::_printCompression()
+{
+    // closed connections + the ones still open
+    qint64 received = _nbBytesReceived, inflated = _nbBytesInflated, sent = _nbBytesSent, deflated = _nbBytesDeflated;
+    for (const NntpCon *con : _connections)
+    {
+        if (const NntpCompression *compression = con->compression())
+        {
+            received += compression->nbBytesReceived();
+            inflated += compression->nbBytesInflated();
+            sent     += compression->nbBytesSent();
+            deflated += compression->nbBytesDeflated();
+        }
+    }
+    qint64 saved = inflated + deflated - received - sent;
+    _cout << tr("Compression: %1 bytes received for %2 inflated, %3 bytes sent for %4 deflated: %5 bytes saved (%6%)").arg(
+                 received).arg(inflated).arg(sent).arg(deflated).arg(saved).arg(
+                 inflated + deflated ? 100. * saved / (inflated + deflated) : 0., 0, 'f', 1) << "\n" << MB_FLUSH;
 }
 
 void NzbCheck::onRefreshprogressbarBar()
 {
-    float progressbar = static_cast<float>(_nbCheckedArticles);
-    progressbar /= _nbTotalArticles;
+    const NzbJob *job = _jobs.first();
+    float progressbar = static_cast<float>(job->nbCheckedArticles);
+    progressbar /= job->nbTotalArticles;
 
     _cout << "\r[";
     int pos = static_cast<int>(std::floor(progressbar * sprogressbarBarWidth));
@@ -108,22 +577,33 @@ void NzbCheck::onRefreshprogressbarBar()
         else _cout << " ";
     }
     _cout << "] " << int(progressbar * 100) << " %"
-              << " (" << _nbCheckedArticles << " / " << _nbTotalArticles << ")"
-              << tr(" missing: ") << _nbMissingArticles;
+              << " (" << job->nbCheckedArticles << " / " << job->nbTotalArticles << ")"
+              << tr(" missing: ") << job->nbMissingArticles;
     _cout.flush();
 
-    if (_nbCheckedArticles < _nbTotalArticles)
+    if (job->nbCheckedArticles < job->nbTotalArticles)
         _progressbarTimer.start(_refreshRate);
 }
 
-NzbCheck::NzbCheck():QObject(),
-    _nzbPath(), _articles(),
+NzbCheck::NzbCheck(QObject *parent):QObject(parent),
+    _nzbPath(), _jobs(), _nextJob(0), _lastJobId(0),
     _cout(stdout), _cerr(stderr),
-    _nbTotalArticles(0),  _nbMissingArticles(0), _nbCheckedArticles(0),
+    _nbMissingArticles(0), _nbRunArticles(0), _nbRunChecked(0),
     _nntpServers(),
-    _debug(0), _connections(),
+    _debug(0), _connections(), _scheduler(nullptr), _pipelineDepth(1),
+    _hedgeBudget(0.), _hedgeTimer(),
+    _compress(false), _tlsResume(false), _sessionTickets(), _deferredCons(), _sharedCons(false), _ledgers(), _ledgerTimer(), _nbBytesReceived(0), _nbBytesInflated(0), _nbBytesSent(0), _nbBytesDeflated(0),
+    _headMode(false), _poolMode(false), _reconnects(),
     _dispProgressBar(false), _progressbarTimer(), _refreshRate(sDefaultRefreshRate),
-    _quietMode(false)
+    _quietMode(false), _offlineMode(false), _matrixMode(false), _matrixArticles(), _nbMatrixArticles(0),
+    _trace(nullptr), _mainTrace(nullptr),
+    _recorder(nullptr), _replay(nullptr),
+    _resultPath(), _binaryResult(false), _previousPath(), _previousMissing(),
+    _rotation(1), _rotationIndex(0), _previousNzb(), _previousFingerprint(), _checkpoint(nullptr), _checkpointTimer(),
+    _deadline(0), _deadlineClock(), _dispatchStopped(false), _finished(false), _teardownClock(),
+    _watchDir(), _watcher(nullptr), _nbJobsInFlight(sDefaultJobsInFlight), _pendingJobs(),
+    _coordinatorPort(0), _coordinator(nullptr), _coordinatorHost(), _worker(nullptr),
+    _brokerName(), _broker(nullptr), _brokerClient(nullptr), _borrowed()
 {}
 
 NzbCheck::~NzbCheck()
@@ -131,111 +611,1110 @@ NzbCheck::~NzbCheck()
     if (_dispProgressBar)
         _progressbarTimer.stop();
 
+    qDeleteAll(_connections); // library API: the pool is still open
+    if (_coordinator)
+        delete _coordinator; // before the job it is working on
+    qDeleteAll(_pendingJobs);
+    qDeleteAll(_jobs);
     qDeleteAll(_nntpServers);
+    if (_scheduler)
+        delete _scheduler;
+    if (_trace)
+    {
+        _writeTrace(); // on every exit, errors included, once the connections are closed
+        delete _trace;
+    }
+    if (_recorder)
+        delete _recorder;
+    if (_replay)
+        delete _replay;
+    if (_checkpoint)
+        delete _checkpoint;
+    if (_worker)
+        delete _worker;
+    if (_broker)
+        delete _broker;
+    if (_brokerClient)
+        delete _brokerClient;
+    qDeleteAll(_ledgers); // release our connection slots
+    if (_watcher)
+        delete _watcher;
+}
+
+TraceBuffer *NzbCheck::newTraceBuffer(const QString &name, int capacity)
+{
+    if (_trace)
+        return _trace->newBuffer(name, capacity);
+    else
+        return nullptr;
+}
+
+void NzbCheck::addServer(const NntpServerParams &srvParams)
+{
+    _nntpServers << new NntpServerParams(srvParams);
+}
+
+bool NzbCheck::startPool()
+{
+    if (_nntpServers.isEmpty())
+    {
+        _cerr << tr("Error: you should at least provide one Usenet provider") << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    // the whole pool stays open (and authenticated) waiting for the jobs
+    _poolMode        = true;
+    _dispProgressBar = false;
+    _nbCons          = 0;
+    for (NntpServerParams *srvParam : _nntpServers)
+    {
+        _startConnections(*srvParam, srvParam->nbCons, sPoolTraceCapacity);
+        _nbCons += srvParam->nbCons;
+    }
+    return true;
+}
+
+int NzbCheck::checkNzb(const QString &nzbPath, const QString &resultPath)
+{
+    NzbJob *job = new NzbJob(++_lastJobId, nzbPath, resultPath);
+    _pendingJobs << job;
+    _startPendingJobs();
+    return job->id;
+}
+
+int NzbCheck::checkSegments(const QString &name, const QVector<NzbFile> &files)
+{
+    NzbJob *job = new NzbJob(++_lastJobId, name, QString());
+    job->files  = files;
+    job->parsed = true;
+    _pendingJobs << job;
+    _startPendingJobs();
+    return job->id;
+}
+
+QString NzbCheck::getNextArticle(NzbJob *&job, const NntpServerParams *srvParams)
+{
+    if (_dispatchStopped)
+    {
+        job = nullptr;
+        return QString();
+    }
+
+    // round robin so all the jobs in flight progress together
+    for (int i = 0; i < _jobs.size(); ++i)
+    {
+        _nextJob = (_nextJob + 1) % _jobs.size();
+        job = _jobs.at(_nextJob);
+        if (job->server && job->server != srvParams)
+            continue; // --matrix: the job of another server
+        QString article = _popArticle(job, srvParams);
+        if (!article.isEmpty())
+        {
+            ++job->nbPendingArticles;
+            return article;
+        }
+    }
+    job = nullptr;
+    return QString();
+}
+
+QString NzbCheck::takeArticle(NzbJob *job)
+{
+    return _popArticle(job, nullptr);
+}
+
+QString NzbCheck::_popArticle(NzbJob *job, const NntpServerParams *srvParams)
+{
+    // the aged Articles first (the oldest ones): only the servers with a longer retention can check them
+    // (any server for a nullptr srvParams)
+    if (!job->agedArticles.isEmpty())
+    {
+        auto it = job->agedArticles.end();
+        while (it != job->agedArticles.begin())
+        {
+            --it;
+            if (!it.value().isEmpty() && (!srvParams || srvParams->covers(it.key())))
+                return it.value().pop();
+        }
+    }
+    if (!job->articles.isEmpty())
+        return job->articles.pop();
+    return QString();
+}
+
+int NzbCheck::_fileAge(const NzbFile &nzbFile) const
+{
+    if (nzbFile.postDate <= 0)
+        return 0;
+    int ageDays = static_cast<int>((QDateTime::currentSecsSinceEpoch() - nzbFile.postDate) / NntpServerParams::sSecondsPerDay);
+    if (coordinatorMode())
+        return ageDays; // no server: the age goes with the Articles to the workers (RANGE)
+    bool coveredByAll = std::all_of(_nntpServers.cbegin(), _nntpServers.cend(),
+                                    [ageDays](const NntpServerParams *srvParams) { return srvParams->covers(ageDays); });
+    return coveredByAll ? 0 : ageDays;
+}
+
+bool NzbCheck::isExpired(int ageDays) const
+{
+    return ageDays > 0 && !coordinatorMode() && std::none_of(_nntpServers.cbegin(), _nntpServers.cend(),
+                                       [ageDays](const NntpServerParams *srvParams) { return srvParams->covers(ageDays); });
+}
+
+void NzbCheck::_queueArticle(NzbJob *job, const QString &article, int ageDays)
+{
+    if (ageDays == 0)
+        job->articles.push(article);
+    else
+    {
+        job->agedArticles[ageDays].push(article);
+        job->articleAges.insert(article, ageDays);
+    }
+}
+
+void NzbCheck::articleChecked(NzbJob *job, const QString &article, bool missing)
+{
+    ++job->nbCheckedArticles;
+    --job->nbPendingArticles;
+    if (missing)
+    {
+        MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+        if (!_quietMode && (!_matrixMode || debugMode()))
+            _cout << (_dispProgressBar ? "\n" : "")
+                  << tr("+ Missing Article on server: ") << article
+                  << (_matrixMode ? QString(" (%1)").arg(job->name()) : QString()) << "\n" << MB_FLUSH;
+        ++job->nbMissingArticles;
+        job->missingArticles << article;
+    }
+    if (_keepsCheckedArticles(job))
+        job->checkedArticles << article;
+    if (_checkpoint)
+        _checkpoint->add(article, missing);
+    emit articleResult(job->id, article, missing);
+
+    if (job->isDone())
+    {
+        if (_poolMode)
+            _finishJob(job);
+        else if (std::all_of(_jobs.cbegin(), _jobs.cend(), [](const NzbJob *aJob) { return aJob->isDone(); }))
+            _finishCheck(); // the result doesn't wait for the connections to close
+    }
+}
+
+void NzbCheck::articleHeadChecked(NzbJob *job, const QString &article, const ArticleHead &head)
+{
+    QStringList reasons;
+    auto it = job->expectedHeads.constFind(article);
+    if (it != job->expectedHeads.cend())
+    {
+        const ExpectedHead &expected = it.value();
+        if (expected.bytes > 0)
+        {
+            if (head.bytes > 0)
+            {
+                if (std::abs(head.bytes - expected.bytes) > sHeadBytesTolerance * expected.bytes)
+                    reasons << tr("%1 bytes instead of %2").arg(head.bytes).arg(expected.bytes);
+            }
+            else if (head.lines > 0)
+            {
+                qint64 expectedLines = expected.bytes / sYencLineLength;
+                if (std::abs(head.lines - expectedLines) > sHeadLinesTolerance * expectedLines + 1)
+                    reasons << tr("%1 lines instead of ~%2").arg(head.lines).arg(expectedLines);
+            }
+        }
+
+        QRegularExpressionMatch match = sSubjectPartRegExp.match(head.subject);
+        if (match.hasMatch())
+        {
+            int part = match.captured(1).toInt(), nbParts = match.captured(2).toInt();
+            if (expected.part > 0 && part != expected.part)
+                reasons << tr("part %1 instead of %2").arg(part).arg(expected.part);
+            if (expected.nbParts > 0 && nbParts != expected.nbParts)
+                reasons << tr("%1 parts instead of %2").arg(nbParts).arg(expected.nbParts);
+        }
+    }
+
+    if (!reasons.isEmpty())
+    {
+        MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+        QString reason = reasons.join(", ");
+        if (!_quietMode)
+            _cout << (_dispProgressBar ? "\n" : "")
+                  << tr("+ Mismatched Article: %1 (%2)").arg(article).arg(reason) << "\n" << MB_FLUSH;
+        ++job->nbMismatchArticles;
+        job->mismatchArticles << article;
+        emit articleMismatch(job->id, article, reason);
+    }
+    articleChecked(job, article, false);
+}
+
+void NzbCheck::articleNotChecked(NzbJob *job, const QString &article)
+{
+    // the connection was lost, give the Article to another one (idle in pool mode or when hedging)
+    --job->nbPendingArticles;
+    _queueArticle(job, article, job->articleAges.value(article, 0));
+    for (NntpCon *con : _connections)
+        emit con->wakeUp();
 }
 
 int NzbCheck::parseNzb()
 {
-    QFile file(_nzbPath);
+    NzbJob *job = new NzbJob(++_lastJobId, _nzbPath, _resultPath);
+    _jobs << job;
+    return _parseNzb(job);
+}
+
+int NzbCheck::_parseNzb(NzbJob *job)
+{
+    QFile file(job->nzbPath);
     if (file.open(QIODevice::ReadOnly|QIODevice::Text))
     {
-        QXmlStreamReader xmlReader(&file);
-        while ( !xmlReader.atEnd() )
+        qint64 parseStart = _mainTrace ? _mainTrace->now() : 0;
+        QElapsedTimer parseTimer;
+        parseTimer.start();
+        QString error;
+        int nbChunks;
         {
-            QXmlStreamReader::TokenType type = xmlReader.readNext();
-            if (type == QXmlStreamReader::TokenType::StartElement
-                    && xmlReader.name() == "file")
+            // the chunks of a parallel parse set PARSE on their threads too, the heap growth of all of them is measured here
+            MemoryStage memoryStage(MemoryStats::Stage::PARSE);
+            nbChunks = NzbParser::parseParallel(file, job->files, error);
+        }
+        if (_mainTrace)
+            _mainTrace->addSpan("parseNzb", parseStart);
+        if (nbChunks < 0)
+        {
+            _cerr << error << "\n" << MB_FLUSH;
+            return -2;
+        }
+        if (debugMode())
+            _cout << tr("%1 parsed in %2 ms (%3 thread(s))").arg(job->name()).arg(parseTimer.elapsed()).arg(nbChunks) << "\n" << MB_FLUSH;
+        return _addArticles(job);
+    }
+    else
+    {
+        _cerr << tr("Error opening nzb file...") << "\n" << MB_FLUSH;
+        return -1;
+    }
+
+}
+
+int NzbCheck::_addArticles(NzbJob *job)
+{
+    MemoryStage memoryStage(MemoryStats::Stage::QUEUE);
+    for (const NzbFile &nzbFile : job->files)
+    {
+        int nbArticles = nzbFile.segments.size(), nbExpectedArticles = nzbFile.nbExpectedSegments;
+        if (debugMode())
+            _cout << tr("The file '%1' has %2 articles in the nzb (expected: %3)").arg(
+                         nzbFile.subject).arg(nbArticles).arg(nbExpectedArticles) << "\n" << MB_FLUSH;
+        if (nbArticles < nbExpectedArticles)
+        {
+            if (!_quietMode)
+                _cout << tr("- %1 missing Article(s) in nzb for '%2'").arg(
+                         nbExpectedArticles - nbArticles).arg(nzbFile.subject) << "\n" << MB_FLUSH;
+
+            job->nbMissingArticles += nbExpectedArticles - nbArticles;
+            job->nbMissingInNzb    += nbExpectedArticles - nbArticles;
+        }
+
+        int ageDays = _fileAge(nzbFile);
+        if (isExpired(ageDays))
+        {
+            // no STAT: none of the servers keeps posts that old
+            if (!_quietMode)
+                _cout << tr("- %1 Article(s) beyond the retention of the servers (%2 days) for '%3'").arg(
+                             nbArticles).arg(ageDays).arg(nzbFile.subject) << "\n" << MB_FLUSH;
+            job->nbExpiredArticles += nbArticles;
+            job->nbMissingArticles += nbArticles;
+            for (const NzbSegment &segment : nzbFile.segments)
+                job->missingArticles << segment.msgId;
+            continue;
+        }
+        if (ageDays > 0 && debugMode())
+            _cout << tr("The file '%1' is %2 days old: only checked on the servers with a longer retention").arg(
+                         nzbFile.subject).arg(ageDays) << "\n" << MB_FLUSH;
+
+        if (_deadline == 0)
+        {
+            for (const NzbSegment &segment : nzbFile.segments)
+                _queueArticle(job, segment.msgId, ageDays);
+        }
+        if (_headMode)
+        {
+            for (const NzbSegment &segment : nzbFile.segments)
+                job->expectedHeads.insert(segment.msgId, {segment.bytes, segment.number, nbExpectedArticles});
+        }
+    }
+    if (_deadline > 0)
+        _pushStratified(job);
+
+    if (_checkpoint && !_openCheckpoint(job))
+        return -1;
+    if (!_previousPath.isEmpty() || (!job->resultPath.isEmpty() && !_binaryResult))
+        job->fingerprint = Checkpoint::fingerprint(job->files);
+
+    // the files are only kept to report the results per file
+    if (!isSignalConnected(QMetaMethod::fromSignal(&NzbCheck::fileResult)) && !(_binaryResult && !job->resultPath.isEmpty()))
+        job->files.clear();
+
+    job->nbTotalArticles   = job->nbQueuedArticles() + job->nbExpiredArticles;
+    job->nbCheckedArticles = job->nbExpiredArticles;
+    if (!_quietMode)
+        _cout << tr("%1 has %2 articles").arg(job->name()).arg(job->nbTotalArticles) << "\n" << MB_FLUSH;
+    if (!_previousPath.isEmpty() && !_poolMode)
+    {
+        if (!_isPreviousOf(job))
+        {
+            _cerr << tr("Error: the previous result %1 is not on %2").arg(_previousPath).arg(job->name()) << "\n" << MB_FLUSH;
+            return -1;
+        }
+        _carryOverPrevious(job);
+    }
+    else if (_checkpoint)
+        _carryOverCheckpoint(job);
+    return job->nbTotalArticles;
+}
+
+bool NzbCheck::checkPost()
+{
+    NzbJob *job = _jobs.first();
+    job->timeStart.start();
+
+    _nbCons = 0;
+    if (job->nbQueuedArticles() == 0)
+    {
+        // everything has been carried over from the previous result (or is beyond retention)
+        _finishCheck();
+        return false;
+    }
+
+    for (NntpServerParams *srvParam : _nntpServers)
+        _nbCons += srvParam->nbCons;
+
+    int nb = 0;
+    if (_brokerClient)
+    {
+        // the borrowed connections come first, our own servers (if any) complete them
+        int nbWanted = job->nbQueuedArticles(); // the broker lends what is idle
+        if (!_borrowConnections(nbWanted, 8 + 2 * (nbWanted / std::min(nbWanted, 10) + 1)) && _nbCons == 0)
+        {
+            _cerr << tr("No connection borrowed from the broker and no server to check with...") << "\n" << MB_FLUSH;
+            _nbMissingArticles = -1;
+            return false;
+        }
+        nb = _connections.size();
+        _nbCons += nb;
+    }
+
+    _nbCons = std::min(job->nbQueuedArticles(), _nbCons);
+
+    // getNextArticle + STAT per Article (_nbCons is 0 if the broker lent an empty list and we have no server)
+    int traceCapacity = 8 + 2 * (job->nbQueuedArticles() / std::max(_nbCons, 1) + 1);
+    if (_sharedCons)
+    {
+        _nbCons = 0; // what the other processes leave us
+        _leaseConnections(traceCapacity);
+        if (_connections.isEmpty() && !_quietMode)
+            _cout << tr("Waiting for a free connection slot (all used by other processes)") << "\n" << MB_FLUSH;
+        connect(&_ledgerTimer, &QTimer::timeout, this, &NzbCheck::onLedgerTimer);
+        _ledgerTimer.start(sLedgerPeriod);
+    }
+    else
+    {
+        for (NntpServerParams *srvParam : _nntpServers)
+        {
+            int nbServerCons = std::min(srvParam->nbCons, _nbCons - nb);
+            _startConnections(*srvParam, nbServerCons, traceCapacity);
+            nb += nbServerCons;
+            if (nb == _nbCons)
+                break;
+        }
+    }
+
+    if (debugMode())
+        _cout << tr("Using %1 Connections").arg(_nbCons) << "\n" << MB_FLUSH;
+
+    _startHedging(job->nbQueuedArticles());
+
+    if (_dispProgressBar)
+    {
+        connect(&_progressbarTimer, &QTimer::timeout, this, &NzbCheck::onRefreshprogressbarBar, Qt::DirectConnection);
+        _progressbarTimer.start(_refreshRate);
+    }
+
+    if (_deadline > 0)
+    {
+        // keep a bit of time to collect the replies in flight
+        qint64 remaining = std::max(static_cast<qint64>(0), _deadline - _deadlineClock.elapsed());
+        qint64 grace     = std::min(remaining / 10, static_cast<qint64>(sMaxDeadlineGrace));
+        QTimer::singleShot(static_cast<int>(remaining - grace), this, &NzbCheck::onStopDispatch);
+        QTimer::singleShot(static_cast<int>(remaining),         this, &NzbCheck::onDeadline);
+    }
+    return true;
+}
+
+void NzbCheck::_pushStratified(NzbJob *job)
+{
+    // round robin between the files, each one sampled evenly,
+    // so whenever we stop the checked Articles cover all the files
+    QVector<QVector<int>> orders;
+    QVector<int> ages;
+    orders.reserve(job->files.size());
+    ages.reserve(job->files.size());
+    int maxSize = 0;
+    for (const NzbFile &nzbFile : job->files)
+    {
+        ages << _fileAge(nzbFile);
+        if (isExpired(ages.last()))
+            orders << QVector<int>(); // already missing
+        else
+            orders << _spreadOrder(static_cast<int>(nzbFile.segments.size()));
+        maxSize = std::max(maxSize, static_cast<int>(orders.last().size()));
+    }
+
+    QVector<QPair<QString, int>> articles;
+    for (int rank = 0; rank < maxSize; ++rank)
+    {
+        for (int f = 0; f < job->files.size(); ++f)
+        {
+            if (rank < orders.at(f).size())
+                articles << qMakePair(job->files.at(f).segments.at(orders.at(f).at(rank)).msgId, ages.at(f));
+        }
+    }
+
+    // the Articles are popped from the top of the stack
+    job->articles.reserve(articles.size());
+    for (auto it = articles.crbegin(), itEnd = articles.crend(); it != itEnd; ++it)
+        _queueArticle(job, it->first, it->second);
+}
+
+QVector<int> NzbCheck::_spreadOrder(int size)
+{
+    // bit-reversed indexes: first, middle, quarters, eighths...
+    int nbBits = 0;
+    while ((1 << nbBits) < size)
+        ++nbBits;
+
+    QVector<int> order;
+    order.reserve(size);
+    for (int i = 0; i < (1 << nbBits); ++i)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < nbBits; ++bit)
+        {
+            if (i & (1 << bit))
+                reversed |= 1 << (nbBits - 1 - bit);
+        }
+        if (reversed < size)
+            order << reversed;
+    }
+    return order;
+}
+
+double NzbCheck::_estimatedCompleteness(const NzbJob *job) const
+{
+    // the checked Articles are an even sample of the nzb
+    int nbExpected = job->nbTotalArticles + job->nbMissingInNzb;
+    if (nbExpected == 0)
+        return 1.;
+    int    nbMissingChecked = job->nbMissingArticles - job->nbMissingInNzb;
+    double missingRatio     = job->nbCheckedArticles ? 1. * nbMissingChecked / job->nbCheckedArticles : 0.;
+    return 1. - (job->nbMissingInNzb + missingRatio * job->nbTotalArticles) / nbExpected;
+}
+
+void NzbCheck::_startConnection(const NntpServerParams &srvParams, int id, int traceCapacity)
+{
+    emit _newConnection(srvParams, id, traceCapacity)->startConnection();
+}
+
+NntpCon *NzbCheck::_newConnection(const NntpServerParams &srvParams, int id, int traceCapacity)
+{
+    if (!_scheduler)
+        _scheduler = new NntpScheduler(this, _pipelineDepth);
+
+    NntpCon *con = new NntpCon(this, id, srvParams,
+                               newTraceBuffer(QString("Con #%1 %2").arg(id).arg(srvParams.host), traceCapacity));
+    connect(con, &NntpCon::disconnected, this, &NzbCheck::onDisconnected, Qt::DirectConnection);
+
+    _connections.insert(con);
+    _scheduler->addConnection(con);
+    return con;
+}
+
+bool NzbCheck::startBroker()
+{
+    _broker = new ConnectionBroker(this);
+    QString error;
+    if (!_broker->listen(_brokerName, error))
+    {
+        _cerr << error << "\n" << MB_FLUSH;
+        return false;
+    }
+    if (!startPool())
+        return false;
+    if (!_quietMode)
+        _cout << tr("Broker of %1 connection(s) listening on %2").arg(_nbCons).arg(
+                     ConnectionBroker::socketPath(_brokerName)) << "\n" << MB_FLUSH;
+    return true;
+}
+
+QList<NntpCon*> NzbCheck::idleConnections() const
+{
+    QList<NntpCon*> cons;
+    for (NntpCon *con : _connections)
+    {
+        if (con->isIdle() && !con->isProxying())
+            cons << con;
+    }
+    return cons;
+}
+
+void NzbCheck::removeConnection(NntpCon *con)
+{
+    _connections.remove(con);
+    _scheduler->removeConnection(con);
+    con->deleteLater();
+}
+
+void NzbCheck::adoptConnection(const NntpServerParams &srvParams, int id, int socketDescriptor)
+{
+    emit _newConnection(srvParams, id, sPoolTraceCapacity)->adoptSocket(socketDescriptor);
+}
+
+void NzbCheck::reopenConnection(const NntpServerParams &srvParams, int id)
+{
+    _startConnections(srvParams, QList<int>() << id, sPoolTraceCapacity); // --tls-resume: the broker's too
+}
+
+bool NzbCheck::_borrowConnections(int nbWanted, int traceCapacity)
+{
+    QList<BrokerClient::Loan> loans;
+    QString error;
+    if (!_brokerClient->borrow(nbWanted, loans, error))
+    {
+        _cerr << error << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    QHash<QString, NntpServerParams*> loanServers;
+    for (const BrokerClient::Loan &loan : loans)
+    {
+        // a plain stream whatever the server (the broker deals with SSL) and no connection of our own
+        QString key = QString("%1:%2").arg(loan.host).arg(loan.port);
+        NntpServerParams *srvParams = loanServers.value(key, nullptr);
+        if (!srvParams)
+        {
+            srvParams = new NntpServerParams(loan.host, loan.port, false, "", "", 0);
+            loanServers.insert(key, srvParams);
+            _nntpServers << srvParams;
+        }
+        NntpCon *con = _newConnection(*srvParams, loan.id, traceCapacity);
+        _borrowed.insert(con, loan.id);
+        emit con->adoptSocket(loan.socketDescriptor);
+    }
+    if (!_quietMode)
+        _cout << tr("%1 connection(s) borrowed from the broker %2").arg(loans.size()).arg(_brokerClient->path()) << "\n" << MB_FLUSH;
+    return !loans.isEmpty();
+}
+
+void NzbCheck::_giveBackConnections()
+{
+    QList<QPair<int, int>> loans;
+    for (NntpCon *con : _connections.values())
+    {
+        auto it = _borrowed.constFind(con);
+        if (it == _borrowed.cend())
+            continue;
+        int fd = con->detachSocket();
+        if (fd < 0)
+            continue; // a reply is still expected: it'll be closed, the broker reopens it
+        loans << qMakePair(it.value(), fd);
+        _borrowed.remove(con);
+        removeConnection(con);
+    }
+    _brokerClient->giveBack(loans);
+    if (debugMode())
+        _cout << tr("%1 connection(s) given back to the broker").arg(loans.size()) << "\n" << MB_FLUSH;
+}
+
+bool NzbCheck::startCoordinator()
+{
+    NzbJob *job = _jobs.first();
+    job->timeStart.start();
+    if (job->nbQueuedArticles() == 0)
+    {
+        // everything has been carried over from the previous result
+        _finishCheck();
+        return false;
+    }
+
+    _nbCons      = 0; // the connections are the workers' ones
+    _coordinator = new ShardCoordinator(this, job);
+    QString error;
+    if (!_coordinator->listen(_coordinatorPort, error))
+    {
+        _cerr << error << "\n" << MB_FLUSH;
+        return false;
+    }
+    if (!_quietMode)
+        _cout << tr("Waiting for the workers on port %1").arg(_coordinatorPort) << "\n" << MB_FLUSH;
+
+    if (_dispProgressBar)
+    {
+        connect(&_progressbarTimer, &QTimer::timeout, this, &NzbCheck::onRefreshprogressbarBar, Qt::DirectConnection);
+        _progressbarTimer.start(_refreshRate);
+    }
+    return true;
+}
+
+bool NzbCheck::startWorker()
+{
+    if (!startPool())
+        return false;
+
+    _worker = new ShardWorker(this, _coordinatorHost, _coordinatorPort);
+    connect(_worker, &ShardWorker::finished, this, &NzbCheck::onWorkerFinished, Qt::QueuedConnection);
+    _worker->start();
+    return true;
+}
+
+void NzbCheck::onWorkerFinished()
+{
+    if (_finished)
+        return;
+    _finished = true; // the pool doesn't reopen its connections anymore
+    _shutdown();
+}
+
+void NzbCheck::_startConnections(const NntpServerParams &srvParams, int nbCons, int traceCapacity)
+{
+    QList<int> ids;
+    for (int i = 1 ; i <= nbCons; ++i)
+        ids << i;
+    _startConnections(srvParams, ids, traceCapacity);
+}
+
+void NzbCheck::_startConnections(const NntpServerParams &srvParams, const QList<int> &ids, int traceCapacity)
+{
+    // --tls-resume: only the first one does the full handshake, the others resume its session (cf sessionReady)
+    // once we have a session they all resume it, while the first one is handshaking the new ones wait behind it
+    bool resume = _tlsResume && srvParams.useSSL && !replayMode() && !_sessionTickets.contains(&srvParams);
+    for (int id : ids)
+    {
+        if (resume && (id != ids.first() || _deferredCons.contains(&srvParams)))
+        {
+            DeferredCons &deferred = _deferredCons[&srvParams];
+            deferred.ids << id;
+            deferred.traceCapacity = traceCapacity;
+        }
+        else
+            _startConnection(srvParams, id, traceCapacity);
+    }
+}
+
+void NzbCheck::sessionReady(const NntpServerParams &srvParams, const QByteArray &sessionTicket)
+{
+    if (!sessionTicket.isEmpty())
+        _sessionTickets.insert(&srvParams, sessionTicket);
+    _startDeferredConnections(srvParams);
+}
+
+void NzbCheck::_startDeferredConnections(const NntpServerParams &srvParams)
+{
+    if (!_deferredCons.contains(&srvParams))
+        return;
+
+    DeferredCons deferred = _deferredCons.take(&srvParams);
+    if (_finished)
+    {
+        // never opened: give their slots back to the other processes (--shared-cons)
+        ConnectionLedger *ledger = _ledgers.value(&srvParams, nullptr);
+        for (int id : deferred.ids)
+        {
+            if (ledger)
+                ledger->release(id - 1);
+        }
+        return;
+    }
+    if (debugMode())
+        _cout << tr("Starting %1 connection(s) on %2 (TLS session %3)").arg(
+                     deferred.ids.size()).arg(srvParams.host).arg(
+                     _sessionTickets.contains(&srvParams) ? tr("resumed") : tr("not resumable")) << "\n" << MB_FLUSH;
+    for (int id : deferred.ids)
+        _startConnection(srvParams, id, deferred.traceCapacity);
+}
+
+QTcpSocket *NzbCheck::newReplaySocket(const NntpServerParams &srvParams, int conId)
+{
+    return _replay->newSocket(_nntpServers.indexOf(const_cast<NntpServerParams*>(&srvParams)), conId);
+}
+
+QString NzbCheck::_resultPathNextTo(const QString &nzbPath) const
+{
+    QFileInfo fi(nzbPath);
+    return QString("%1/%2.%3").arg(fi.absolutePath()).arg(fi.completeBaseName()).arg(_binaryResult ? "nzbr" : "json");
+}
+
+bool NzbCheck::startWatching()
+{
+    _watcher = new NzbWatcher(_watchDir);
+    QString error;
+    if (!_watcher->start(error))
+    {
+        _cerr << error << "\n" << MB_FLUSH;
+        return false;
+    }
+    connect(_watcher, &NzbWatcher::nzbReady, this, &NzbCheck::onNzbReady);
+
+    if (!startPool())
+        return false;
+
+    if (!_quietMode)
+        _cout << tr("Watching %1 (%2 nzb(s) in flight using %3 connections)").arg(
+                     _watchDir).arg(_nbJobsInFlight).arg(_nbCons) << "\n" << MB_FLUSH;
+
+    // nzbs dropped while we were not watching
+    for (const QString &nzbPath : _watcher->nzbsInFolder())
+    {
+        if (!QFileInfo::exists(_resultPathNextTo(nzbPath)))
+            onNzbReady(nzbPath);
+    }
+    return true;
+}
+
+QStringList NzbCheck::_inputNzbs() const
+{
+    QStringList nzbPaths;
+    QFileInfo fi(_nzbPath);
+    if (fi.isDir())
+    {
+        QDir dir(_nzbPath);
+        for (const QFileInfo &nzbFile : dir.entryInfoList({"*.nzb"}, QDir::Files|QDir::Readable, QDir::Name))
+            nzbPaths << nzbFile.absoluteFilePath();
+    }
+    else
+        nzbPaths << _nzbPath;
+    return nzbPaths;
+}
+
+bool NzbCheck::checkMatrix()
+{
+    QStringList nzbPaths = _inputNzbs();
+    if (nzbPaths.isEmpty())
+    {
+        _cerr << tr("Error: no nzb file in %1").arg(_nzbPath) << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    // one single parse: the Articles of all the nzbs (without duplicates)
+    qint64 parseStart = _mainTrace ? _mainTrace->now() : 0;
+    QSet<QString> msgIds;
+    for (const QString &nzbPath : nzbPaths)
+    {
+        QFile file(nzbPath);
+        if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+        {
+            _cerr << tr("Error opening nzb file %1").arg(nzbPath) << "\n" << MB_FLUSH;
+            continue;
+        }
+        QVector<NzbFile> nzbFiles;
+        QString          error;
+        bool             parsed;
+        {
+            MemoryStage memoryStage(MemoryStats::Stage::PARSE);
+            parsed = NzbParser::parse(&file, nzbFiles, error);
+        }
+        if (!parsed)
+        {
+            _cerr << QFileInfo(nzbPath).fileName() << ": " << error << "\n" << MB_FLUSH;
+            continue;
+        }
+        MemoryStage memoryStage(MemoryStats::Stage::QUEUE);
+        for (const NzbFile &nzbFile : nzbFiles)
+        {
+            for (const NzbSegment &segment : nzbFile.segments)
             {
-                QString subject = xmlReader.attributes().value("subject").toString();
-                QRegularExpressionMatch match = sNntpArticleYencSubjectRegExp.match(subject);
-                int nbArticles = 0, nbExpectedArticles = 0;
-                if (match.hasMatch())
-                    nbExpectedArticles = match.captured(1).toInt();
-                while ( !xmlReader.atEnd() )
+                if (!msgIds.contains(segment.msgId))
                 {
-                    QXmlStreamReader::TokenType type = xmlReader.readNext();
-                    if (type == QXmlStreamReader::TokenType::EndElement
-                            && xmlReader.name() == "file")
-                    {
-                        if (debugMode())
-                            _cout << tr("The file '%1' has %2 articles in the nzb (expected: %3)").arg(
-                                         subject).arg(nbArticles).arg(nbExpectedArticles) << "\n" << MB_FLUSH;
-                        if (nbArticles < nbExpectedArticles)
-                        {
-                            if (!_quietMode)
-                                _cout << tr("- %1 missing Article(s) in nzb for '%2'").arg(
-                                         nbExpectedArticles - nbArticles).arg(subject) << "\n" << MB_FLUSH;
-
-                            _nbMissingArticles += nbExpectedArticles - nbArticles;
-                        }
-
-                        break;
-                    }
-                    else if (type == QXmlStreamReader::TokenType::StartElement
-                            && xmlReader.name() == "segment")
-                    {
-                        ++nbArticles;
-                        xmlReader.readNext();
-                        _articles.push(QString("<%1>").arg(xmlReader.text().toString()));
-                    }
+                    msgIds.insert(segment.msgId);
+                    _matrixArticles << segment.msgId;
                 }
             }
         }
+    }
+    if (_mainTrace)
+        _mainTrace->addSpan("parseNzb", parseStart);
 
-        if (xmlReader.hasError()) {
-            _cerr << "parsing error: " << xmlReader.errorString()
-                      << " at line: " << xmlReader.lineNumber() << "\n" << MB_FLUSH;
-            return -2;
+    if (_matrixArticles.isEmpty())
+    {
+        _cerr << tr("Error: no Article to check...") << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    // one job per server with all the Articles: each server checks them with its own connections
+    int nbArticles = static_cast<int>(_matrixArticles.size());
+    _nbCons = 0;
+    for (NntpServerParams *srvParam : _nntpServers)
+    {
+        NzbJob *job = new NzbJob(++_lastJobId, srvParam->host, QString());
+        job->server = srvParam;
+        for (const QString &msgId : _matrixArticles)
+            job->articles.push(msgId);
+        job->nbTotalArticles = nbArticles;
+        job->timeStart.start();
+        _jobs << job;
+
+        int nbCons = std::min(nbArticles, srvParam->nbCons);
+        int traceCapacity = 8 + 2 * (nbArticles / nbCons + 1); // getNextArticle + STAT per Article
+        for (int i = 1 ; i <= nbCons; ++i)
+            _startConnection(*srvParam, i, traceCapacity);
+        _nbCons += nbCons;
+    }
+
+    _startHedging(nbArticles * static_cast<int>(_nntpServers.size()));
+
+    if (!_quietMode)
+        _cout << tr("%1 Article(s) from %2 nzb(s) checked on %3 server(s) using %4 connections").arg(
+                     nbArticles).arg(nzbPaths.size()).arg(_nntpServers.size()).arg(_nbCons) << "\n" << MB_FLUSH;
+    return true;
+}
+
+void NzbCheck::_printMatrix()
+{
+    // bit s of the masks of an Article: present on / replied by the server s
+    const int     nbServers  = _jobs.size();
+    const int     nbArticles = static_cast<int>(_matrixArticles.size());
+    const quint32 allServers = (1u << nbServers) - 1;
+    quint32 finished = 0; // servers that replied for all the Articles (the others lost their connections)
+    QVector<quint32> masks(nbArticles, 0), checkedMasks(nbArticles, 0);
+    for (int s = 0; s < nbServers; ++s)
+    {
+        const NzbJob *job = _jobs.at(s);
+        QSet<QString> missingArticles, checkedArticles;
+        for (const QString &article : job->missingArticles)
+            missingArticles.insert(article);
+        for (const QString &article : job->checkedArticles)
+            checkedArticles.insert(article);
+        if (checkedArticles.size() == nbArticles)
+            finished |= 1u << s;
+        for (int a = 0; a < nbArticles; ++a)
+        {
+            const QString &article = _matrixArticles.at(a);
+            if (!checkedArticles.contains(article))
+                continue; // unknown: neither present nor missing
+            checkedMasks[a] |= 1u << s;
+            if (!missingArticles.contains(article))
+                masks[a] |= 1u << s;
+        }
+    }
+    QHash<quint32, int> nbArticlesPerMask;
+    QVector<int> nbUnique(nbServers, 0);
+    int nbUnknown = 0;
+    _nbMissingArticles = 0;
+    for (int a = 0; a < nbArticles; ++a)
+    {
+        quint32 mask = masks.at(a);
+        ++nbArticlesPerMask[mask];
+        bool allReplied = checkedMasks.at(a) == allServers;
+        if (mask == 0)
+        {
+            if (allReplied)
+                ++_nbMissingArticles;
+            else
+                ++nbUnknown; // maybe on a server that didn't reply
+        }
+        else if (allReplied && qPopulationCount(mask) == 1)
+            ++nbUnique[qCountTrailingZeroBits(mask)];
+    }
+    _nbMatrixArticles = nbArticles; // for _printMemoryStats
+    _matrixArticles.clear();
+
+    auto coverage = [&nbArticlesPerMask](quint32 servers) {
+        int nb = 0;
+        for (auto it = nbArticlesPerMask.cbegin(), itEnd = nbArticlesPerMask.cend(); it != itEnd; ++it)
+        {
+            if (it.key() & servers)
+                nb += it.value();
+        }
+        return nb;
+    };
+    auto percent = [nbArticles](int nb) {
+        return QString("%1%").arg(100. * nb / nbArticles, 0, 'f', 1);
+    };
+
+    if (_quietMode)
+        return;
+
+    int nameWidth = 6;
+    for (const NzbJob *job : _jobs)
+        nameWidth = std::max(nameWidth, static_cast<int>(job->name().size()));
+    nameWidth = std::min(nameWidth, 40);
+
+    _cout << "\n" << QString("%1 %2 %3 %4 %5").arg(
+                 tr("server"), -nameWidth).arg(
+                 tr("present"), 16).arg(
+                 tr("unique"), 8).arg(
+                 tr("missing"), 8).arg(
+                 tr("unchecked"), 10) << "\n";
+    for (int s = 0; s < nbServers; ++s)
+    {
+        const NzbJob *job = _jobs.at(s);
+        int nbPresent = coverage(1u << s);
+        _cout << QString("%1 %2 %3 %4 %5").arg(
+                     job->name().left(nameWidth), -nameWidth).arg(
+                     QString("%1 (%2)").arg(nbPresent).arg(percent(nbPresent)), 16).arg(
+                     nbUnique.at(s), 8).arg(
+                     job->nbMissingArticles, 8).arg(
+                     nbArticles - job->checkedArticles.size(), 10) << "\n";
+    }
+    if (finished != allServers)
+        _cout << tr("Unique and overlap are unknown (?) where a server couldn't check all the Articles") << "\n";
+
+    if (nbServers > 1)
+    {
+        _cout << "\n" << tr("Overlap (Articles present on both servers):") << "\n"
+              << QString(nameWidth, ' ');
+        for (int s = 0; s < nbServers; ++s)
+            _cout << QString(" %1").arg(QString("#%1").arg(s + 1), 10);
+        _cout << "\n";
+        for (int s1 = 0; s1 < nbServers; ++s1)
+        {
+            _cout << QString("#%1 %2").arg(s1 + 1).arg(_jobs.at(s1)->name().left(nameWidth - 3), -(nameWidth - 3));
+            for (int s2 = 0; s2 < nbServers; ++s2)
+            {
+                quint32 both = (1u << s1) | (1u << s2);
+                if ((finished & both) != both)
+                {
+                    _cout << QString(" %1").arg("?", 10);
+                    continue;
+                }
+                int nb = 0;
+                for (auto it = nbArticlesPerMask.cbegin(), itEnd = nbArticlesPerMask.cend(); it != itEnd; ++it)
+                {
+                    if ((it.key() & both) == both)
+                        nb += it.value();
+                }
+                _cout << QString(" %1").arg(nb, 10);
+            }
+            _cout << "\n";
+        }
+
+        // exhaustive: we don't have more than sMaxMatrixServers
+        // only between the servers that finished: an unchecked Article would count as missing
+        _cout << "\n" << tr("Best combinations:") << "\n";
+        const int nbFinished = static_cast<int>(qPopulationCount(finished));
+        for (int nbChosen = 1; nbChosen <= nbFinished; ++nbChosen)
+        {
+            quint32 best = 0;
+            int bestCoverage = -1;
+            for (quint32 servers = 1; servers < (1u << nbServers); ++servers)
+            {
+                if ((servers & ~finished) != 0 || static_cast<int>(qPopulationCount(servers)) != nbChosen)
+                    continue;
+                int nb = coverage(servers);
+                if (nb > bestCoverage)
+                {
+                    best         = servers;
+                    bestCoverage = nb;
+                }
+            }
+            QStringList names;
+            for (int s = 0; s < nbServers; ++s)
+            {
+                if (best & (1u << s))
+                    names << _jobs.at(s)->name();
+            }
+            _cout << QString("  %1 server(s): %2 => %3 (%4)").arg(nbChosen).arg(
+                         names.join(" + ")).arg(bestCoverage).arg(percent(bestCoverage)) << "\n";
+            if (bestCoverage == coverage(finished))
+                break; // adding servers won't help
+        }
+        if (finished != allServers)
+        {
+            QStringList names;
+            for (int s = 0; s < nbServers; ++s)
+            {
+                if (!(finished & (1u << s)))
+                    names << _jobs.at(s)->name();
+            }
+            _cout << "  " << tr("not compared (check incomplete): %1").arg(names.join(", ")) << "\n";
         }
-        _nbTotalArticles = _articles.size();
-        if (!_quietMode)
-            _cout << tr("%1 has %2 articles").arg(QFileInfo(_nzbPath).fileName()).arg(_nbTotalArticles) << "\n" << MB_FLUSH;
-        return _nbTotalArticles;
-    }
-    else
-    {
-        _cerr << tr("Error opening nzb file...") << "\n" << MB_FLUSH;
-        return -1;
     }
 
+    _cout << "\n" << tr("Nb Article(s) missing on all servers: %1/%2 (check done in %3 using %4 connections on %5 server(s))").arg(
+                 _nbMissingArticles).arg(
+                 nbArticles).arg(
+                 QTime::fromMSecsSinceStartOfDay(static_cast<int>(_jobs.first()->timeStart.elapsed())).toString("hh:mm:ss.zzz")).arg(
+                 _nbCons).arg(
+                 nbServers) << "\n";
+    if (nbUnknown > 0)
+        _cout << tr("Nb Article(s) unknown (missing on the servers that replied, unchecked on the others): %1").arg(nbUnknown) << "\n";
+    _cout << MB_FLUSH;
 }
 
-void NzbCheck::checkPost()
+int NzbCheck::analyseOffline()
 {
-    _timeStart.start();
-
-    _nbCons = 0;
-    for (NntpServerParams *srvParam : _nntpServers)
-        _nbCons += srvParam->nbCons;
-
-    _nbCons = std::min(_nbTotalArticles, _nbCons);
-
-    int nb = 0;
-    for (NntpServerParams *srvParam : _nntpServers)
+    QStringList nzbPaths = _inputNzbs();
+    if (nzbPaths.isEmpty())
     {
-        for (int i = 1 ; i <= srvParam->nbCons; ++i)
-        {
-            NntpCon *con = new NntpCon(this, i, *srvParam);
-            connect(con, &NntpCon::disconnected, this, &NzbCheck::onDisconnected, Qt::DirectConnection);
-            emit con->startConnection();
+        _cerr << tr("Error: no nzb file in %1").arg(_nzbPath) << "\n" << MB_FLUSH;
+        return -1;
+    }
 
-            _connections.insert(con);
+    _timeStart.start();
+    // one nzb per core: the global pool has QThread::idealThreadCount() threads
+    QList<NzbAnalysis> analyses = QtConcurrent::blockingMapped<QList<NzbAnalysis>>(nzbPaths, &NzbAnalysis::analyse);
+    qint64 duration = _timeStart.elapsed();
 
-            if (++nb == _nbCons)
-                break;
-        }
-        if (nb == _nbCons)
-            break;
+    int nbUnhealthy = 0, nameWidth = 3;
+    for (const NzbAnalysis &analysis : analyses)
+    {
+        if (!analysis.isHealthy())
+            ++nbUnhealthy;
+        nameWidth = std::max(nameWidth, static_cast<int>(QFileInfo(analysis.nzbPath).fileName().size()));
     }
+    nameWidth = std::min(nameWidth, 60);
 
-    if (debugMode())
-        _cout << tr("Using %1 Connections").arg(_nbCons) << "\n" << MB_FLUSH;
-
-    if (_dispProgressBar)
+    if (!_quietMode)
     {
-        connect(&_progressbarTimer, &QTimer::timeout, this, &NzbCheck::onRefreshprogressbarBar, Qt::DirectConnection);
-        _progressbarTimer.start(_refreshRate);
+        _cout << QString("%1 %2 %3 %4 %5 %6 %7 %8").arg(
+                     tr("nzb"), -nameWidth).arg(
+                     tr("files"), 6).arg(
+                     tr("segments"), 9).arg(
+                     tr("expected"), 9).arg(
+                     tr("missing"), 8).arg(
+                     tr("dupes"), 6).arg(
+                     tr("0-byte"), 6).arg(
+                     tr("par2"), 5) << "\n";
+        for (const NzbAnalysis &analysis : analyses)
+        {
+            QString name = QFileInfo(analysis.nzbPath).fileName().left(nameWidth);
+            if (!analysis.error.isEmpty())
+            {
+                _cout << QString("%1 %2").arg(name, -nameWidth).arg(analysis.error) << "\n";
+                continue;
+            }
+            _cout << QString("%1 %2 %3 %4 %5 %6 %7 %8").arg(
+                         name, -nameWidth).arg(
+                         analysis.nbFiles, 6).arg(
+                         analysis.nbSegments, 9).arg(
+                         analysis.nbExpectedSegments, 9).arg(
+                         analysis.nbMissingSegments, 8).arg(
+                         analysis.nbDuplicateSegments, 6).arg(
+                         analysis.nbZeroByteSegments, 6).arg(
+                         analysis.hasPar2 ? tr("yes") : tr("NO"), 5) << "\n";
+            if (debugMode())
+            {
+                for (const QString &incompleteFile : analysis.incompleteFiles)
+                    _cout << "\t- " << tr("incomplete: ") << incompleteFile << "\n";
+            }
+        }
+        _cout << tr("%1 nzb(s) analysed in %2 (%3 thread(s)), %4 with issue(s)").arg(
+                     analyses.size()).arg(
+                     QTime::fromMSecsSinceStartOfDay(static_cast<int>(duration)).toString("hh:mm:ss.zzz")).arg(
+                     QThreadPool::globalInstance()->maxThreadCount()).arg(
+                     nbUnhealthy) << "\n" << MB_FLUSH;
     }
+    return nbUnhealthy;
 }
 
 bool NzbCheck::parseCommandLine(int argc, char *argv[])
@@ -271,7 +1750,56 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
         return false;
     }
 
-    if (!parser.isSet(sOptionNames[Opt::INPUT]))
+    if (parser.isSet(sOptionNames[Opt::OFFLINE]))
+        _offlineMode = true;
+    if (parser.isSet(sOptionNames[Opt::MATRIX]))
+        _matrixMode = true;
+
+    if (parser.isSet(sOptionNames[Opt::WATCH]))
+    {
+        _watchDir = parser.value(sOptionNames[Opt::WATCH]);
+        QFileInfo fi(_watchDir);
+        if (!fi.exists() || !fi.isDir() || !fi.isReadable())
+        {
+            _cerr << tr("Error: please provide a readable folder to watch...") << "\n" << MB_FLUSH;
+            return false;
+        }
+        if (parser.isSet(sOptionNames[Opt::JOBS]))
+        {
+            bool ok;
+            _nbJobsInFlight = parser.value(sOptionNames[Opt::JOBS]).toInt(&ok);
+            if (!ok || _nbJobsInFlight < 1)
+            {
+                _cerr << tr("You should give a positive integer for the number of jobs (option -j)") << "\n" << MB_FLUSH;
+                return false;
+            }
+        }
+    }
+    else if (parser.isSet(sOptionNames[Opt::WORKER]))
+    {
+        QRegularExpression regExp("^(.+):(\\d+)$");
+        QRegularExpressionMatch match = regExp.match(parser.value(sOptionNames[Opt::WORKER]));
+        if (match.hasMatch())
+        {
+            _coordinatorHost = match.captured(1);
+            _coordinatorPort = match.captured(2).toUShort();
+        }
+        if (_coordinatorHost.isEmpty() || _coordinatorPort == 0)
+        {
+            _cerr << tr("Error: please provide the coordinator as <host>:<port> (option --worker)") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+    else if (parser.isSet(sOptionNames[Opt::BROKER]))
+    {
+        if (_matrixMode || _offlineMode || parser.isSet(sOptionNames[Opt::COORDINATOR]))
+        {
+            _cerr << tr("--broker is not available with --matrix, --offline or --coordinator") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _brokerName = parser.value(sOptionNames[Opt::BROKER]);
+    }
+    else if (!parser.isSet(sOptionNames[Opt::INPUT]))
     {
         _cerr << tr("Error syntax: you should provide at least one input file or directory using the option -i");
         return false;
@@ -280,14 +1808,14 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
     {
         _nzbPath = parser.value(sOptionNames[Opt::INPUT]);
         QFileInfo fi(_nzbPath);
-        if (!fi.exists() || !fi.isFile() || !fi.isReadable())
+        if (!fi.exists() || !(fi.isFile() || ((_offlineMode || _matrixMode) && fi.isDir())) || !fi.isReadable())
         {
             _cerr << tr("Error: please provide a readable nzb file...") << "\n" << MB_FLUSH;
             return false;
         }
     }
 
-    if (parser.isSet(sOptionNames[Opt::PROGRESS]))
+    if (parser.isSet(sOptionNames[Opt::PROGRESS]) && !watchMode() && !_matrixMode)
         _dispProgressBar = true;
 
     if (parser.isSet(sOptionNames[Opt::QUIET]))
@@ -299,6 +1827,12 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
     if (parser.isSet(sOptionNames[Opt::DEBUG]))
         _debug = 1;
 
+    if (parser.isSet(sOptionNames[Opt::TRACE]))
+    {
+        _trace     = new TraceRecorder(parser.value(sOptionNames[Opt::TRACE]));
+        _mainTrace = _trace->newBuffer(sAppName, 16);
+    }
+
 
     if (parser.isSet(sOptionNames[Opt::SERVER]))
     {
@@ -307,7 +1841,7 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
         for (const QString &serverParam : parser.values(sOptionNames[Opt::SERVER]))
         {
             QRegularExpressionMatch match = regExp.match(serverParam);
-            if (match.hasMatch())
+            if (match.hasMatch() && match.captured(6).toInt() > 0)
             {
                 bool    auth  = !match.captured(1).isEmpty();
                 QString user  = match.captured(2);
@@ -316,6 +1850,7 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
                 ushort  port  = match.captured(5).toUShort();
                 int     nbCon = match.captured(6).toInt();
                 bool    ssl   = match.captured(7).isEmpty();
+                int     retention = match.captured(9).toInt(); // 0 if not given: unlimited
 #ifdef __DEBUG__
                 qDebug() << "NNTP Server: " << user << ":" << pass
                          << "@" << host << ":" << port << ":" << nbCon << ":" << ssl;
@@ -326,13 +1861,14 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
                                                                 user.toStdString(),
                                                                 pass.toStdString(),
                                                                 nbCon,
-                                                                ssl);
+                                                                ssl,
+                                                                retention);
                 _nntpServers << server;
             }
             else
             {
                 _cerr << tr("Syntax error on server details for %1, the format should be: %2").arg(
-                           serverParam).arg("(<user>:<pass>@@@)?<host>:<port>:<nbCons>:(no)?ssl");
+                           serverParam).arg("(<user>:<pass>@@@)?<host>:<port>:<nbCons>:(no)?ssl(:<retention>d)?");
                 return false;
             }
         }
@@ -380,27 +1916,464 @@ bool NzbCheck::parseCommandLine(int argc, char *argv[])
         {
             bool ok;
             int nbCons = parser.value(sOptionNames[Opt::CONNECTION]).toInt(&ok);
-            if (ok)
+            if (ok && nbCons > 0)
                 server->nbCons = nbCons;
             else
             {
-                _cerr << tr("You should give an integer for the number of connections (option -n)");
+                _cerr << tr("You should give a positive integer for the number of connections (option -n)");
                 return false;
             }
         }
     }
 
-    if (_nntpServers.isEmpty())
+    if (parser.isSet(sOptionNames[Opt::RESULT]))
+        _resultPath = parser.value(sOptionNames[Opt::RESULT]);
+
+    if (parser.isSet(sOptionNames[Opt::RESULT_FORMAT]))
+    {
+        QString format = parser.value(sOptionNames[Opt::RESULT_FORMAT]).toLower();
+        if (format == "bin")
+            _binaryResult = true;
+        else if (format != "json")
+        {
+            _cerr << tr("The result format should be json or bin (option --result-format)") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::ROTATE]))
+    {
+        bool ok;
+        _rotation = parser.value(sOptionNames[Opt::ROTATE]).toInt(&ok);
+        if (!ok || _rotation < 1)
+        {
+            _cerr << tr("You should give a positive integer for the rotation (option --rotate)") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::PREVIOUS]) && !watchMode())
+    {
+        _previousPath = parser.value(sOptionNames[Opt::PREVIOUS]);
+        if (!_loadPrevious())
+            return false;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::REPLAY]))
+    {
+        double speed = 1.;
+        if (parser.isSet(sOptionNames[Opt::REPLAY_SPEED]))
+        {
+            bool ok;
+            speed = parser.value(sOptionNames[Opt::REPLAY_SPEED]).toDouble(&ok);
+            if (!ok || speed < 0.)
+            {
+                _cerr << tr("You should give a positive number for the replay speed (option --replay-speed)") << "\n" << MB_FLUSH;
+                return false;
+            }
+        }
+
+        // the servers are the recorded ones
+        qDeleteAll(_nntpServers);
+        _nntpServers.clear();
+        _replay = new SessionReplay(speed);
+        QString error;
+        if (!_replay->load(parser.value(sOptionNames[Opt::REPLAY]), _nntpServers, error))
+        {
+            _cerr << error << "\n" << MB_FLUSH;
+            return false;
+        }
+        if (debugMode())
+            _cout << tr("Replaying %1 exchanges on %2 server(s) (speed: %3)").arg(
+                         _replay->nbExchanges()).arg(_nntpServers.size()).arg(speed) << "\n" << MB_FLUSH;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::COORDINATOR]))
+    {
+        if (watchMode() || workerMode() || _matrixMode || _offlineMode)
+        {
+            _cerr << tr("--coordinator is not available with --watch, --worker, --matrix or --offline") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _coordinatorPort = parser.value(sOptionNames[Opt::COORDINATOR]).toUShort();
+        if (_coordinatorPort == 0)
+        {
+            _cerr << tr("You should give a port to listen on (option --coordinator)") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::USE_BROKER]))
+    {
+        if (brokerMode() || watchMode() || workerMode() || coordinatorMode() || _matrixMode || _offlineMode || _replay)
+        {
+            _cerr << tr("--use-broker is not available with --broker, --watch, --worker, --coordinator, --matrix, --offline or --replay") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _brokerName   = parser.value(sOptionNames[Opt::USE_BROKER]);
+        _brokerClient = new BrokerClient(_brokerName);
+    }
+
+    if (parser.isSet(sOptionNames[Opt::CHECKPOINT]))
+    {
+        if (watchMode() || workerMode() || coordinatorMode() || brokerMode() || _matrixMode || _offlineMode || !_previousPath.isEmpty())
+        {
+            _cerr << tr("--checkpoint is not available with --watch, --worker, --coordinator, --broker, --matrix, --offline or --previous") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _checkpoint = new Checkpoint(parser.value(sOptionNames[Opt::CHECKPOINT]));
+    }
+
+    if (_nntpServers.isEmpty() && !_offlineMode && !coordinatorMode() && !_brokerClient)
     {
         _cerr << tr("Error: you should at least provide one Usenet provider using -S or (-h, -p, -u, -P...)") << "\n" << MB_FLUSH;
         return false;
     }
+    if (_matrixMode && _nntpServers.size() > sMaxMatrixServers)
+    {
+        _cerr << tr("Error: the matrix mode is limited to %1 servers").arg(sMaxMatrixServers) << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::PIPELINE]))
+    {
+        bool ok;
+        _pipelineDepth = parser.value(sOptionNames[Opt::PIPELINE]).toInt(&ok);
+        if (!ok || _pipelineDepth < 1)
+        {
+            _cerr << tr("You should give a positive integer for the pipeline depth (option --pipeline)") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::COMPRESS]))
+    {
+        if (!_brokerName.isEmpty())
+        {
+            _cerr << tr("--compress is not available with --broker or --use-broker (a compressed stream can't be handed over)") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _compress = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::TLS_RESUME]))
+        _tlsResume = true;
+
+    if (parser.isSet(sOptionNames[Opt::MEMSTATS]))
+        MemoryStats::setEnabled(true);
+
+    if (parser.isSet(sOptionNames[Opt::HEAD]))
+    {
+        if (_replay)
+        {
+            _cerr << tr("--head is not available with --replay (the records only hold STAT)") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _headMode = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::SHARED_CONS]))
+    {
+        if (watchMode() || _matrixMode || _replay || workerMode() || !_brokerName.isEmpty())
+        {
+            _cerr << tr("--shared-cons is not available with --watch, --matrix, --replay, --worker or the brokers") << "\n" << MB_FLUSH;
+            return false;
+        }
+        _sharedCons = true;
+    }
+
+    if (parser.isSet(sOptionNames[Opt::HEDGE]))
+    {
+        bool ok;
+        _hedgeBudget = parser.value(sOptionNames[Opt::HEDGE]).toDouble(&ok);
+        if (!ok || _hedgeBudget <= 0.)
+        {
+            _cerr << tr("You should give a positive percentage of duplicate STAT (option --hedge)") << "\n" << MB_FLUSH;
+            return false;
+        }
+        if (watchMode() || workerMode())
+        {
+            _cerr << tr("Hedging is not available with --watch or --worker") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::DEADLINE]))
+    {
+        _deadlineClock.start();
+        QRegularExpression regExp("^(\\d+(?:\\.\\d+)?)(ms|s|m)?$");
+        QRegularExpressionMatch match = regExp.match(parser.value(sOptionNames[Opt::DEADLINE]));
+        if (match.hasMatch())
+        {
+            double value = match.captured(1).toDouble();
+            QString unit = match.captured(2);
+            _deadline = static_cast<qint64>(unit == "ms" ? value : unit == "m" ? value * 60000 : value * 1000);
+        }
+        if (_deadline <= 0)
+        {
+            _cerr << tr("You should give a duration for the deadline (ex: 3s, 500ms, 1m) (option --deadline)") << "\n" << MB_FLUSH;
+            return false;
+        }
+        if (watchMode() || _matrixMode || workerMode() || coordinatorMode())
+        {
+            _cerr << tr("The deadline is not available with --watch, --matrix, --worker or --coordinator") << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+    if (parser.isSet(sOptionNames[Opt::RECORD]))
+    {
+        _recorder = new SessionRecorder(parser.value(sOptionNames[Opt::RECORD]), _nntpServers);
+        QString error;
+        if (!_recorder->open(error))
+        {
+            _cerr << error << "\n" << MB_FLUSH;
+            return false;
+        }
+    }
+
+
+
+    return true;
+}
+
+void NzbCheck::_writeTrace()
+{
+    QString error;
+    if (_trace->write(error))
+    {
+        if (!_quietMode)
+            _cout << tr("Trace written in %1").arg(_trace->filePath()) << "\n" << MB_FLUSH;
+    }
+    else
+        _cerr << error << "\n" << MB_FLUSH;
+}
+
+bool NzbCheck::_loadPrevious()
+{
+    if (ResultFile::isResultFile(_previousPath))
+    {
+        _cerr << tr("Error: %1 is a binary result, --previous needs a json one (--result-format json)").arg(
+                     _previousPath) << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    QFile file(_previousPath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        _cerr << tr("Error opening previous result %1: %2").arg(_previousPath).arg(file.errorString()) << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    QJsonParseError error;
+    QJsonDocument   doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+    {
+        _cerr << tr("Error parsing previous result %1: %2").arg(_previousPath).arg(error.errorString()) << "\n" << MB_FLUSH;
+        return false;
+    }
+
+    QJsonObject previous = doc.object();
+    _previousNzb         = previous.value("nzb").toString();
+    _previousFingerprint = QByteArray::fromHex(previous.value("fingerprint").toString().toLatin1());
+    for (const QJsonValue &article : previous.value("missing").toArray())
+        _previousMissing.insert(article.toString());
+
+    // the next slice of the rotation
+    if (previous.value("rotate").toInt() == _rotation)
+        _rotationIndex = (previous.value("rotation").toInt() + 1) % _rotation;
+
+    return true;
+}
+
+bool NzbCheck::_isPreviousOf(const NzbJob *job) const
+{
+    // results written before the fingerprint only have the name
+    if (_previousFingerprint.isEmpty())
+        return _previousNzb == job->name();
+    return _previousFingerprint == job->fingerprint;
+}
+
+void NzbCheck::_carryOverPrevious(NzbJob *job)
+{
+    // the expired Articles are missing without being queued (the only missing ones so far):
+    // the ones that were already missing are not newly missing
+    for (const QString &article : job->missingArticles)
+    {
+        if (_previousMissing.contains(article))
+            ++job->nbExpiredPreviouslyMissing;
+    }
+
+    job->filterArticles([this, job](const QString &article) {
+        if (_previousMissing.contains(article))
+        {
+            // missing Articles stay missing
+            ++job->nbMissingArticles;
+            ++job->nbCarriedArticles;
+            ++job->nbCarriedMissing;
+            if (!job->resultPath.isEmpty())
+                job->missingArticles << article;
+            return false;
+        }
+        else if (_rotationSlice(article) != _rotationIndex)
+        {
+            ++job->nbCarriedArticles; // present and not in this slice of the rotation
+            if (_keepsCheckedArticles(job))
+                job->checkedArticles << article;
+            return false;
+        }
+        return true;
+    });
+    job->nbCheckedArticles += job->nbCarriedArticles;
 
+    if (job->nbCarriedMissing + job->nbExpiredPreviouslyMissing != _previousMissing.size())
+        _cerr << tr("Warning: some Articles of the previous result are not in %1").arg(job->name()) << "\n" << MB_FLUSH;
 
+    if (!_quietMode)
+        _cout << tr("%1 Article(s) to recheck (%2 were missing in the previous result)").arg(
+                     job->nbQueuedArticles()).arg(job->nbCarriedMissing) << "\n" << MB_FLUSH;
+}
+
+int NzbCheck::_rotationSlice(const QString &article) const
+{
+    // FNV-1a: stable across runs (unlike qHash) so an Article stays in its slice whatever the order of the nzb
+    quint32 hash = 2166136261u;
+    for (const QChar &c : article)
+    {
+        hash ^= c.unicode();
+        hash *= 16777619u;
+    }
+    return static_cast<int>(hash % static_cast<quint32>(_rotation));
+}
 
+bool NzbCheck::_openCheckpoint(NzbJob *job)
+{
+    QString error;
+    if (!_checkpoint->open(job->files, error))
+    {
+        _cerr << error << "\n" << MB_FLUSH;
+        return false;
+    }
+    connect(&_checkpointTimer, &QTimer::timeout, this, [this](){ _checkpoint->flush(); });
+    _checkpointTimer.start(sCheckpointPeriod);
     return true;
 }
 
+void NzbCheck::_carryOverCheckpoint(NzbJob *job)
+{
+    if (_checkpoint->nbResumed() == 0)
+        return;
+
+    job->filterArticles([this, job](const QString &article) {
+        bool missing = false;
+        if (!_checkpoint->isChecked(article, missing))
+            return true;
+        ++job->nbCarriedArticles;
+        if (missing)
+        {
+            ++job->nbMissingArticles;
+            ++job->nbCarriedMissing;
+            if (!job->resultPath.isEmpty())
+                job->missingArticles << article;
+        }
+        else if (_keepsCheckedArticles(job))
+            job->checkedArticles << article;
+        return false;
+    });
+    job->nbCheckedArticles += job->nbCarriedArticles;
+
+    if (!_quietMode)
+        _cout << tr("Resuming from the checkpoint %1: %2 Article(s) already checked (%3 missing), %4 left").arg(
+                     _checkpoint->filePath()).arg(job->nbCarriedArticles).arg(job->nbCarriedMissing).arg(
+                     job->nbQueuedArticles()) << "\n" << MB_FLUSH;
+}
+
+void NzbCheck::_writeResult(NzbJob *job)
+{
+    if (_binaryResult)
+    {
+        _writeBinaryResult(job);
+        return;
+    }
+
+    MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+    QJsonArray missing, newlyMissing;
+    for (const QString &article : job->missingArticles)
+    {
+        missing.append(article);
+        if (!_previousPath.isEmpty() && !_previousMissing.contains(article))
+            newlyMissing.append(article);
+    }
+
+    QJsonObject result;
+    result.insert("nzb",            job->name());
+    if (!job->fingerprint.isEmpty())
+        result.insert("fingerprint", QString(job->fingerprint.toHex()));
+    result.insert("date",           QDateTime::currentDateTime().toString(Qt::ISODate));
+    result.insert("nbArticles",     job->nbTotalArticles);
+    result.insert("nbMissingInNzb", job->nbMissingInNzb);
+    result.insert("nbChecked",      job->nbCheckedArticles - job->nbCarriedArticles - job->nbExpiredArticles);
+    result.insert("nbCarriedOver",  job->nbCarriedArticles);
+    result.insert("nbExpired",      job->nbExpiredArticles);
+    result.insert("nbMissing",      job->nbMissingArticles);
+    result.insert("rotate",         _rotation);
+    result.insert("rotation",       _rotationIndex);
+    if (_deadline > 0)
+    {
+        result.insert("deadline",              _deadline);
+        result.insert("exhaustive",            job->nbCheckedArticles == job->nbTotalArticles);
+        result.insert("estimatedCompleteness", _estimatedCompleteness(job));
+    }
+    result.insert("missing",        missing);
+    if (_headMode)
+    {
+        result.insert("nbMismatch", job->nbMismatchArticles);
+        result.insert("mismatch",   QJsonArray::fromStringList(job->mismatchArticles));
+    }
+    if (!_previousPath.isEmpty())
+        result.insert("newlyMissing", newlyMissing);
+
+    QFile file(job->resultPath);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)
+            || file.write(QJsonDocument(result).toJson()) == -1)
+        _cerr << tr("Error writing result %1: %2").arg(job->resultPath).arg(file.errorString()) << "\n" << MB_FLUSH;
+    else if (debugMode())
+        _cout << tr("Result written in %1").arg(job->resultPath) << "\n" << MB_FLUSH;
+}
+
+void NzbCheck::_writeBinaryResult(NzbJob *job)
+{
+    MemoryStage memoryStage(MemoryStats::Stage::OUTPUT);
+    QSet<QString> missing, checked;
+    missing.reserve(job->missingArticles.size());
+    for (const QString &article : job->missingArticles)
+        missing.insert(article);
+    // the missing ones are known too (expired, carried over)
+    checked.reserve(job->checkedArticles.size() + missing.size());
+    for (const QString &article : job->checkedArticles)
+        checked.insert(article);
+    checked.unite(missing);
+
+    QVector<ResultFile::FileResult> files;
+    files.reserve(job->files.size());
+    for (const NzbFile &nzbFile : job->files)
+        files << ResultFile::FileResult{nzbFile.subject, nzbFile.segments.size(), nzbFile.nbExpectedSegments,
+                                        ResultFile::missingRanges(nzbFile, missing),
+                                        ResultFile::uncheckedRanges(nzbFile, checked)};
+
+    QString error;
+    if (!ResultFile::write(job->resultPath, job->name(), job->nbTotalArticles, job->nbMissingArticles,
+                           job->nbCheckedArticles, files, error))
+        _cerr << error << "\n" << MB_FLUSH;
+    else if (debugMode())
+        _cout << tr("Result written in %1 (%2 file(s))").arg(job->resultPath).arg(files.size()) << "\n" << MB_FLUSH;
+}
+
+bool NzbCheck::_keepsCheckedArticles(const NzbJob *job) const
+{
+    return _matrixMode || (_binaryResult && !job->resultPath.isEmpty());
+}
+
 void NzbCheck::_showVersionASCII()
 {
     _cout << sASCII
@@ -424,7 +2397,10 @@ void NzbCheck::_syntax(char *appName)
     }
     _cout << "\nExamples:\n"
           << "  - " << appName << " --progress -S \"user:password@@@news.usenetserver.com:563:50:ssl\" -i /nzb/myNzbFile.nzb\n"
-          << "  - " << appName << " --quiet -h news.usenetserver.com -P 563 -u user -p password -n 50 -s -i /nzb/myNzbFile.nzb\n\n";
+          << "  - " << appName << " --quiet -h news.usenetserver.com -P 563 -u user -p password -n 50 -s -i /nzb/myNzbFile.nzb\n"
+          << "  - " << appName << " --offline -i /nzb/\n"
+          << "  - " << appName << " --matrix -S \"news.provider1.com:563:20:ssl\" -S \"news.provider2.com:563:20:ssl\" -i /nzb/\n"
+          << "  - " << appName << " --quiet -S \"user:password@@@news.usenetserver.com:563:50:ssl\" --watch /nzb/spool -j 4\n\n";
 
 }
 
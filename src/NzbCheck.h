@@ -26,11 +26,28 @@
 #include <QString>
 #include <QTextStream>
 #include <QSet>
+#include <QHash>
 #include <QTimer>
 #include <QCommandLineOption>
 #include <QElapsedTimer>
+#include "NzbJob.h"
 class NntpServerParams;
 class NntpCon;
+class NzbWatcher;
+class NntpScheduler;
+class TraceRecorder;
+class TraceBuffer;
+class SessionRecorder;
+class SessionReplay;
+class QTcpSocket;
+class NntpCompression;
+class ConnectionLedger;
+class ShardCoordinator;
+class ShardWorker;
+class Checkpoint;
+class ConnectionBroker;
+class BrokerClient;
+class NntpCon;
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
     #define MB_FLUSH flush
@@ -45,11 +62,12 @@ class NzbCheck : public QObject
 private:
     static constexpr const char *sAppName = "nzbCheck";
     static constexpr const char *sVersion = "1.3";
-    static constexpr const char *sNntpServerStrRegExp = "^(([^:]+):([^@]+)@@@)?([\\w\\.\\-_]+):(\\d+):(\\d+):(no)?ssl$";
-    static constexpr const char *sNntpArticleYencSubjectStrRegExp = "^\\[\\d+/\\d+\\]\\s+.+\\(\\d+/(\\d+)\\)$";
+    static constexpr const char *sNntpServerStrRegExp = "^(([^:]+):([^@]+)@@@)?([\\w\\.\\-_]+):(\\d+):(\\d+):(no)?ssl(:(\\d+)d)?$";
 
     enum class Opt {HELP = 0, VERSION,
-                    PROGRESS, DEBUG, QUIET,
+                    PROGRESS, DEBUG, QUIET, OFFLINE, MATRIX, TRACE, MEMSTATS, RECORD, REPLAY, REPLAY_SPEED,
+                    RESULT, RESULT_FORMAT, PREVIOUS, ROTATE, CHECKPOINT, WATCH, JOBS, COORDINATOR, WORKER, DEADLINE, PIPELINE, HEDGE, COMPRESS, HEAD, SHARED_CONS, TLS_RESUME,
+                    BROKER, USE_BROKER,
                     INPUT, SERVER, HOST, PORT, SSL, USER, PASS, CONNECTION
                    };
 
@@ -57,14 +75,16 @@ private:
     static const QList<QCommandLineOption> sCmdOptions;
 
     QString           _nzbPath;
-    QStack<QString>   _articles;
+    QList<NzbJob*>    _jobs;         //!< nzbs being checked (only one unless we watch a folder)
+    int               _nextJob;      //!< round robin between the _jobs to give the Articles
+    int               _lastJobId;    //!< id given to the last job (checkNzb, checkSegments)
 
     QTextStream       _cout; //!< stream for stdout
     QTextStream       _cerr; //!< stream for stderr
 
-    int               _nbTotalArticles;
-    int               _nbMissingArticles;
-    int               _nbCheckedArticles;
+    int               _nbMissingArticles; //!< of the finished jobs (exit code)
+    qint64            _nbRunArticles;     //!< Articles of the finished jobs (memory stats)
+    qint64            _nbRunChecked;      //!< Articles STATed by the finished jobs (memory stats)
 
 
     QList<NntpServerParams*> _nntpServers; //!< the servers parameters
@@ -72,44 +92,192 @@ private:
     ushort            _debug;
 
     QSet<NntpCon*>    _connections;
+    NntpScheduler    *_scheduler;     //!< hands the Articles to the _connections
+    int               _pipelineDepth; //!< STAT in flight per connection (--pipeline)
+    double            _hedgeBudget;   //!< max duplicate STAT in % of the Articles (--hedge), 0 for no hedging
+    QTimer            _hedgeTimer;    //!< looks for stragglers to hedge
+    bool              _compress;      //!< negotiate COMPRESS DEFLATE (--compress)
+    bool              _tlsResume;     //!< SSL connections resume the session of the first one of their server (--tls-resume)
+    QHash<const NntpServerParams*, QByteArray> _sessionTickets; //!< last TLS session of each server (--tls-resume)
+    struct DeferredCons {
+        QList<int> ids;
+        int        traceCapacity;
+    };
+    QHash<const NntpServerParams*, DeferredCons> _deferredCons; //!< waiting for the TLS session of the first connection
+    bool              _sharedCons;    //!< nbCons is the limit of the account for all the processes of the host (--shared-cons)
+    QHash<const NntpServerParams*, ConnectionLedger*> _ledgers; //!< connection slots leased per server (--shared-cons)
+    QTimer            _ledgerTimer;   //!< lease the slots released by the other processes
+    qint64            _nbBytesReceived, _nbBytesInflated, _nbBytesSent, _nbBytesDeflated; //!< of the closed connections
+    bool              _headMode;      //!< HEAD instead of STAT to compare each Article with the nzb (--head)
+    bool              _poolMode;      //!< connections stay open waiting for new jobs (startPool)
+    struct Reconnect {
+        int  delay;       //!< ms before reopening a lost connection, doubled after each failed login
+        bool authRefused; //!< our credentials were refused (481/482): the server is not retried
+
+        qint64 notBefore; //!< --shared-cons: epoch ms before leasing its slots again
+
+        Reconnect() : delay(0), authRefused(false), notBefore(0) {}
+    };
+    QHash<const NntpServerParams*, Reconnect> _reconnects; //!< backoff per server (pool and --shared-cons)
 
     bool              _dispProgressBar;
     QTimer            _progressbarTimer;      //!< timer to refresh the upload information (progressbar bar, avg. speed)
     const int         _refreshRate;           //!< refresh rate
 
     bool              _quietMode;
+    bool              _offlineMode; //!< only analyse the structure of the nzb(s), no network
+    bool              _matrixMode;  //!< check all the Articles on each server (--matrix)
+    QStringList       _matrixArticles; //!< Articles of all the nzbs in matrix mode (bitmap index)
+    int               _nbMatrixArticles; //!< size of _matrixArticles (freed once the matrix is printed)
 
     QElapsedTimer     _timeStart;
     int               _nbCons;
 
+    TraceRecorder    *_trace;     //!< timeline of the run (--trace)
+    TraceBuffer      *_mainTrace; //!< spans of the main thread (parsing)
+
+    SessionRecorder  *_recorder;  //!< exchanges of the connections (--record)
+    SessionReplay    *_replay;    //!< recorded session replacing the network (--replay)
+
+    QString           _resultPath;        //!< json result file (--result)
+    bool              _binaryResult;      //!< the result is a ResultFile instead of json (--result-format bin)
+    QString           _previousPath;      //!< json result of a previous run (--previous)
+    QSet<QString>     _previousMissing;   //!< Articles missing in the previous result (they stay missing)
+    int               _rotation;          //!< recheck only 1/_rotation of the Articles previously present (--rotate)
+    int               _rotationIndex;     //!< slice of the rotation rechecked in this run
+    QString           _previousNzb;       //!< name of the nzb of the previous result
+    QByteArray        _previousFingerprint; //!< of the nzb of the previous result (empty if it has none)
+    Checkpoint       *_checkpoint;        //!< state of the check saved to resume it (--checkpoint)
+    QTimer            _checkpointTimer;   //!< flushes the checkpoint
+
+    qint64            _deadline;          //!< ms to give an answer (--deadline), 0 for no limit
+    QElapsedTimer     _deadlineClock;     //!< started with the run
+    bool              _dispatchStopped;   //!< close to the deadline: no more STAT sent
+    bool              _finished;          //!< the result has been given (deadline or all checked)
+    QElapsedTimer     _teardownClock;     //!< started when the connections are closed after the result
+
+    QString           _watchDir;          //!< folder watched for new nzbs (--watch)
+    NzbWatcher       *_watcher;
+    int               _nbJobsInFlight;    //!< max nzbs checked concurrently in watch mode (--jobs)
+    QList<NzbJob*>    _pendingJobs;       //!< jobs waiting for a slot in pool mode
+
+    ushort            _coordinatorPort;   //!< port we listen on (--coordinator) or of our coordinator (--worker)
+    ShardCoordinator *_coordinator;
+    QString           _coordinatorHost;   //!< coordinator we work for (--worker)
+    ShardWorker      *_worker;
+
+    QString           _brokerName;        //!< name of the broker we are (--broker) or we borrow from (--use-broker)
+    ConnectionBroker *_broker;
+    BrokerClient     *_brokerClient;
+    QHash<NntpCon*, int> _borrowed;       //!< loan id of the connections borrowed from the broker
+
+    static const int sDefaultJobsInFlight = 2;
+    static const int sCheckpointPeriod    = 2000; //!< ms between the flushes of the checkpoint (what a kill can lose)
+    static const int sMaxMatrixServers    = 12; //!< the best combinations are searched exhaustively
+    static const int sMaxDeadlineGrace    = 500; //!< max ms to collect the replies in flight after the dispatch stopped
+    static const int sShutdownTimeout     = 1000; //!< ms given to the connections to close after the result
+    static const int sHedgePeriod         = 50;  //!< ms between two looks for stragglers
+    static const int sLedgerPeriod        = 1000; //!< ms between two leases of the free connection slots
+    static const int sReconnectDelay      = 5000; //!< ms before reopening a lost connection in pool mode
+    static const int sMaxReconnectDelay   = 300000; //!< cap of the backoff when the server keeps failing
+    static const int sPoolTraceCapacity   = 1024; //!< spans preallocated per connection in pool mode
+
+    static const double sHeadBytesTolerance; //!< relative difference allowed between the Bytes header and the nzb
+    static const double sHeadLinesTolerance; //!< same when only the Lines header is there
+    static const int    sYencLineLength = 130; //!< bytes of a yEnc line (128 + CRLF) to estimate the Lines
+    static const QRegularExpression sSubjectPartRegExp; //!< "(x/N)" at the end of an Article subject
+
     static const int sDefaultRefreshRate  = 200; //!< how often shall we refresh the progressbar bar?
 #if defined( Q_OS_WIN )
     static const int sprogressbarBarWidth = 30;
 #else
     static const int sprogressbarBarWidth = 50;
 #endif
-    static const QRegularExpression sNntpArticleYencSubjectRegExp;
 
 public slots:
     void onDisconnected(NntpCon *con);
     void onRefreshprogressbarBar();
+    void onNzbReady(const QString &nzbPath);
+    void onStopDispatch();
+    void onDeadline();
+    void onShutdownTimeout();
+    void onHedgeTimer();
+    void onLedgerTimer();
+    void onWorkerFinished();
+
+signals:
+    //! an Article of the job jobId has been checked on the servers
+    void articleResult(int jobId, const QString &msgId, bool missing);
+    //! the Article is present but its headers don't match the nzb (--head)
+    void articleMismatch(int jobId, const QString &msgId, const QString &reason);
+    //! per file summary when the job is finished (only emitted if connected before the job starts)
+    void fileResult(int jobId, const QString &subject, int nbArticles, int nbMissing);
+    //! nbMissing includes the Articles expected from the yEnc subjects but not in the nzb
+    void jobFinished(int jobId, int nbArticles, int nbMissing);
+    void jobError(int jobId, const QString &error);
 
 
 public:
-    NzbCheck();
+    NzbCheck(QObject *parent = nullptr);
     ~NzbCheck();
 
+    // library API: add the servers, startPool then queue the jobs (results come by signals)
+    void addServer(const NntpServerParams &srvParams);
+    inline void setQuietMode(bool quiet);
+    inline void setPipelineDepth(int depth);
+    inline void setHeadMode(bool head);
+    inline void setCompressMode(bool compress);
+    inline void setJobsInFlight(int nbJobs);
+    bool startPool();
+    int checkNzb(const QString &nzbPath, const QString &resultPath = QString());
+    int checkSegments(const QString &name, const QVector<NzbFile> &files);
+
     int parseNzb();
-    void checkPost();
+    bool checkPost();
+    int analyseOffline();
+    bool checkMatrix();
+    bool startWatching();
+    bool startCoordinator();
+    bool startWorker();
+    bool startBroker();
 
     bool parseCommandLine(int argc, char *argv[]);
 
 
-    inline void missingArticle(const QString &article);
-    inline QString getNextArticle();
-    inline void articleChecked();
-
+    TraceBuffer *newTraceBuffer(const QString &name, int capacity);
+
+    QString getNextArticle(NzbJob *&job, const NntpServerParams *srvParams);
+    QString takeArticle(NzbJob *job); //!< next queued Article whatever its age (ShardCoordinator: the workers have their own servers)
+    bool isExpired(int ageDays) const; //!< beyond the retention of all the servers (never for the coordinator: the workers decide)
+    void articleChecked(NzbJob *job, const QString &article, bool missing);
+    void articleHeadChecked(NzbJob *job, const QString &article, const ArticleHead &head);
+    void articleNotChecked(NzbJob *job, const QString &article);
+
+    QTcpSocket *newReplaySocket(const NntpServerParams &srvParams, int conId);
+    void addCompressionStats(const NntpCompression &compression);
+    void sessionReady(const NntpServerParams &srvParams, const QByteArray &sessionTicket);
+    inline QByteArray sessionTicket(const NntpServerParams &srvParams) const;
+
+    // ConnectionBroker API: lend the idle connections of the pool
+    QList<NntpCon*> idleConnections() const;
+    void removeConnection(NntpCon *con);
+    void adoptConnection(const NntpServerParams &srvParams, int id, int socketDescriptor);
+    void reopenConnection(const NntpServerParams &srvParams, int id);
+
+    inline NntpScheduler *scheduler() const;
+    inline SessionRecorder *recorder() const;
+    inline bool replayMode() const;
+    inline bool compressMode() const;
+    inline bool headMode() const;
+    inline bool tlsResumeMode() const;
     inline int nbMissingArticles() const;
+    inline bool offlineMode() const;
+    inline bool matrixMode() const;
+    inline bool watchMode() const;
+    inline bool coordinatorMode() const;
+    inline bool workerMode() const;
+    inline bool brokerMode() const;
+    inline bool poolMode() const;
     inline bool debugMode() const;
     inline void setDebug(ushort level);
 
@@ -125,28 +293,73 @@ private:
     static const QString sASCII;
     void _showVersionASCII();
     void _syntax(char *appName);
+    void _writeTrace();
+
+    int  _parseNzb(NzbJob *job);
+    int  _addArticles(NzbJob *job);
+    void _startConnection(const NntpServerParams &srvParams, int id, int traceCapacity);
+    NntpCon *_newConnection(const NntpServerParams &srvParams, int id, int traceCapacity);
+    bool _borrowConnections(int nbWanted, int traceCapacity);
+    void _giveBackConnections();
+    void _startConnections(const NntpServerParams &srvParams, int nbCons, int traceCapacity);
+    void _startConnections(const NntpServerParams &srvParams, const QList<int> &ids, int traceCapacity);
+    void _startDeferredConnections(const NntpServerParams &srvParams);
+    int  _reconnectDelay(const NntpCon *con); //!< ms before reopening a lost connection (-1 for never)
+    void _finishCheck();
+    void _shutdown();
+    void _startHedging(int nbArticles);
+    void _leaseConnections(int traceCapacity);
+    void _quit();
+    void _finishJob(NzbJob *job);
+    void _startPendingJobs();
+    void _printSummary(NzbJob *job);
+    void _printCompression();
+    void _printMemoryStats();
+    void _emitResults(NzbJob *job);
+    void _printMatrix();
+    void _pushStratified(NzbJob *job);
+    void _queueArticle(NzbJob *job, const QString &article, int ageDays);
+    QString _popArticle(NzbJob *job, const NntpServerParams *srvParams);
+    int  _fileAge(const NzbFile &nzbFile) const; //!< days since the post if some servers don't cover it (0 otherwise)
+    double _estimatedCompleteness(const NzbJob *job) const;
+    static QVector<int> _spreadOrder(int size);
+    static qint64 _cpuTimeMs(); //!< user + system CPU of the process (-1 if not available)
+    QStringList _inputNzbs() const;
+    QString _resultPathNextTo(const QString &nzbPath) const;
+    bool _loadPrevious();
+    bool _isPreviousOf(const NzbJob *job) const; //!< the previous result is on the same nzb
+    void _carryOverPrevious(NzbJob *job);
+    int  _rotationSlice(const QString &article) const;
+    bool _openCheckpoint(NzbJob *job);
+    void _carryOverCheckpoint(NzbJob *job);
+    void _writeResult(NzbJob *job);
+    void _writeBinaryResult(NzbJob *job);
+    bool _keepsCheckedArticles(const NzbJob *job) const; //!< the unchecked Articles are reported (--matrix, binary result)
 };
 
-void NzbCheck::missingArticle(const QString &article)
-{
-    if (!_quietMode)
-        _cout << (_dispProgressBar ? "\n" : "")
-              << tr("+ Missing Article on server: ") << article << "\n" << MB_FLUSH;
-    ++_nbMissingArticles;
-}
-
-QString NzbCheck::getNextArticle()
-{
-    if (_articles.isEmpty())
-        return QString();
-    else
-        return _articles.pop();
-}
-
-void NzbCheck::articleChecked() { ++_nbCheckedArticles; }
-
+NntpScheduler *NzbCheck::scheduler() const { return _scheduler; }
+SessionRecorder *NzbCheck::recorder() const { return _recorder; }
+bool NzbCheck::replayMode() const { return _replay != nullptr; }
+bool NzbCheck::compressMode() const { return _compress && !_replay; } // the record is not compressed
+bool NzbCheck::headMode() const { return _headMode; }
+bool NzbCheck::tlsResumeMode() const { return _tlsResume; }
+QByteArray NzbCheck::sessionTicket(const NntpServerParams &srvParams) const { return _sessionTickets.value(&srvParams); }
 int NzbCheck::nbMissingArticles() const { return _nbMissingArticles; }
 
+bool NzbCheck::offlineMode() const { return _offlineMode; }
+bool NzbCheck::matrixMode() const { return _matrixMode; }
+bool NzbCheck::watchMode() const { return !_watchDir.isEmpty(); }
+bool NzbCheck::coordinatorMode() const { return _coordinatorPort != 0 && _coordinatorHost.isEmpty(); }
+bool NzbCheck::workerMode() const { return !_coordinatorHost.isEmpty(); }
+bool NzbCheck::brokerMode() const { return !_brokerName.isEmpty() && !_brokerClient; }
+bool NzbCheck::poolMode() const { return _poolMode; }
+
+void NzbCheck::setQuietMode(bool quiet) { _quietMode = quiet; }
+void NzbCheck::setPipelineDepth(int depth) { _pipelineDepth = depth; }
+void NzbCheck::setHeadMode(bool head) { _headMode = head; }
+void NzbCheck::setCompressMode(bool compress) { _compress = compress; }
+void NzbCheck::setJobsInFlight(int nbJobs) { _nbJobsInFlight = nbJobs; }
+
 bool NzbCheck::debugMode() const { return _debug != 0; }
 void NzbCheck::setDebug(ushort level) { _debug = level; }
 
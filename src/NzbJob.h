@@ -0,0 +1,136 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NZBJOB_H
+#define NZBJOB_H
+
+#include <QString>
+#include <QStringList>
+#include <QStack>
+#include <QHash>
+#include <QMap>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include "NzbParser.h"
+struct NntpServerParams;
+
+//! what the nzb tells about an Article (--head)
+struct ExpectedHead
+{
+    qint64 bytes;   //!< bytes attribute of the segment (-1 if not provided)
+    int    part;    //!< number attribute of the segment (0 if not provided)
+    int    nbParts; //!< from the yEnc subject of the file (0 if not yEnc)
+};
+
+//! what the server tells about an Article (HEAD reply)
+struct ArticleHead
+{
+    QString subject;
+    qint64  bytes; //!< Bytes header (-1 if not provided)
+    int     lines; //!< Lines header (-1 if not provided)
+
+    ArticleHead() : subject(), bytes(-1), lines(-1) {}
+};
+
+/*!
+ * \brief state of the check of one nzb
+ * the connections of the NzbCheck pool pick its Articles and report on it
+ */
+struct NzbJob
+{
+    const int       id;                //!< given by NzbCheck, used in its signals
+    const QString   nzbPath;           //!< or the name given to checkSegments
+    const QString   resultPath;        //!< json result (empty if not written)
+
+    QStack<QString> articles;          //!< Articles still to check
+    QMap<int, QStack<QString>> agedArticles; //!< Articles still to check older than the retention of some servers (by age in days)
+    QHash<QString, int> articleAges;   //!< age of the aged Articles (to requeue them)
+
+    int             nbTotalArticles;
+    int             nbMissingArticles;
+    int             nbCheckedArticles;
+    int             nbMissingInNzb;    //!< Articles expected from the yEnc subjects but not in the nzb
+    int             nbPendingArticles; //!< Articles given to a connection and not answered yet
+    int             nbCarriedArticles; //!< Articles not checked, their status comes from the previous result
+    int             nbCarriedMissing;  //!< carried over Articles that were missing
+    int             nbExpiredArticles; //!< older than the retention of all the servers: missing without STAT
+    int             nbExpiredPreviouslyMissing; //!< expired Articles already missing in the previous result (--previous)
+    QStringList     missingArticles;
+    QStringList     checkedArticles;   //!< only kept with --matrix or a binary result: tells the unchecked Articles
+    int             nbMismatchArticles; //!< present but not matching the nzb (--head)
+    QStringList     mismatchArticles;
+    QHash<QString, ExpectedHead> expectedHeads; //!< only filled with --head
+    QVector<NzbFile> files;            //!< only kept if NzbCheck::fileResult is connected
+    bool            parsed;            //!< files given already parsed (NzbCheck::checkSegments)
+    const NntpServerParams *server;    //!< only checked on this server (--matrix), nullptr for any
+    QByteArray      fingerprint;       //!< of the Articles of the nzb (Checkpoint::fingerprint) for the json result and --previous
+
+    QElapsedTimer   timeStart;
+
+    NzbJob(int aId, const QString &aNzbPath, const QString &aResultPath):
+        id(aId), nzbPath(aNzbPath), resultPath(aResultPath), articles(), agedArticles(), articleAges(),
+        nbTotalArticles(0), nbMissingArticles(0), nbCheckedArticles(0), nbMissingInNzb(0),
+        nbPendingArticles(0), nbCarriedArticles(0), nbCarriedMissing(0), nbExpiredArticles(0), nbExpiredPreviouslyMissing(0),
+        missingArticles(), checkedArticles(), nbMismatchArticles(0), mismatchArticles(), expectedHeads(), files(), parsed(false), server(nullptr), fingerprint(), timeStart()
+    {}
+
+    NzbJob(const NzbJob &other) = delete;
+    NzbJob & operator=(const NzbJob &other) = delete;
+
+    inline bool isDone() const;
+    inline QString name() const;
+    inline int nbQueuedArticles() const; //!< still to give to a connection (aged ones included)
+
+    //! keep only the queued Articles for which keep(article) is true (aged ones included)
+    template <typename Keep> void filterArticles(Keep keep);
+};
+
+bool NzbJob::isDone() const { return nbQueuedArticles() == 0 && nbPendingArticles == 0; }
+
+int NzbJob::nbQueuedArticles() const
+{
+    int nbQueued = articles.size();
+    for (const QStack<QString> &aged : agedArticles)
+        nbQueued += aged.size();
+    return nbQueued;
+}
+
+template <typename Keep>
+void NzbJob::filterArticles(Keep keep)
+{
+    auto filter = [&keep](QStack<QString> &stack) {
+        QStack<QString> kept;
+        kept.reserve(stack.size());
+        for (const QString &article : stack)
+        {
+            if (keep(article))
+                kept.push(article);
+        }
+        stack.swap(kept);
+    };
+    filter(articles);
+    for (auto it = agedArticles.begin(), itEnd = agedArticles.end(); it != itEnd; ++it)
+        filter(it.value());
+}
+
+QString NzbJob::name() const { return QFileInfo(nzbPath).fileName(); }
+
+#endif // NZBJOB_H
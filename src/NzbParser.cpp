@@ -0,0 +1,234 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbParser.h"
+#include "MemoryStats.h"
+#include <QIODevice>
+#include <QFile>
+#include <QThread>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace
+{
+//! read only device over pieces of memory one after the other (no copy of the mapped nzb)
+class PiecesDevice : public QIODevice
+{
+public:
+    explicit PiecesDevice(const QList<QByteArray> &pieces) : QIODevice(), _pieces(pieces), _size(0), _piece(0), _pos(0)
+    {
+        for (const QByteArray &piece : _pieces)
+            _size += piece.size();
+        open(QIODevice::ReadOnly);
+    }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return _size - _consumed() + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        qint64 nbRead = 0;
+        while (nbRead < maxSize && _piece < _pieces.size())
+        {
+            const QByteArray &piece = _pieces.at(_piece);
+            qint64 size = std::min(maxSize - nbRead, static_cast<qint64>(piece.size()) - _pos);
+            memcpy(data + nbRead, piece.constData() + _pos, static_cast<size_t>(size));
+            nbRead += size;
+            _pos   += size;
+            if (_pos == piece.size())
+            {
+                ++_piece;
+                _pos = 0;
+            }
+        }
+        return nbRead;
+    }
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    const QList<QByteArray> _pieces;
+    qint64                  _size;
+    int                     _piece;
+    qint64                  _pos;   //!< in the current piece
+
+    qint64 _consumed() const
+    {
+        qint64 consumed = _pos;
+        for (int i = 0; i < _piece; ++i)
+            consumed += _pieces.at(i).size();
+        return consumed;
+    }
+};
+
+struct Chunk
+{
+    qint64           begin;
+    qint64           end;
+    QVector<NzbFile> files;
+    QString          error;
+    bool             parsed;
+};
+
+//! position of the next <file element from pos (-1 if none)
+qint64 nextFileElement(const QByteArray &data, qint64 pos)
+{
+    while ((pos = data.indexOf("<file", static_cast<int>(pos))) != -1)
+    {
+        char next = pos + 5 < data.size() ? data.at(static_cast<int>(pos + 5)) : '\0';
+        if (next == ' ' || next == '>' || next == '\t' || next == '\n' || next == '\r')
+            return pos;
+        pos += 5; // <files...
+    }
+    return -1;
+}
+}
+
+const QRegularExpression NzbParser::sNntpArticleYencSubjectRegExp = QRegularExpression(sNntpArticleYencSubjectStrRegExp);
+
+bool NzbParser::parse(QIODevice *device, QVector<NzbFile> &files, QString &error)
+{
+    QXmlStreamReader xmlReader(device);
+    while ( !xmlReader.atEnd() )
+    {
+        QXmlStreamReader::TokenType type = xmlReader.readNext();
+        if (type == QXmlStreamReader::TokenType::StartElement
+                && xmlReader.name() == "file")
+        {
+            NzbFile nzbFile;
+            nzbFile.subject            = xmlReader.attributes().value("subject").toString();
+            nzbFile.postDate           = xmlReader.attributes().value("date").toLongLong();
+            nzbFile.nbExpectedSegments = expectedSegments(nzbFile.subject);
+            while ( !xmlReader.atEnd() )
+            {
+                QXmlStreamReader::TokenType type = xmlReader.readNext();
+                if (type == QXmlStreamReader::TokenType::EndElement
+                        && xmlReader.name() == "file")
+                    break;
+                else if (type == QXmlStreamReader::TokenType::StartElement
+                        && xmlReader.name() == "segment")
+                {
+                    QXmlStreamAttributes attributes = xmlReader.attributes();
+                    bool ok;
+                    NzbSegment segment;
+                    segment.bytes  = attributes.value("bytes").toLongLong(&ok);
+                    if (!ok)
+                        segment.bytes = -1;
+                    segment.number = attributes.value("number").toInt();
+                    xmlReader.readNext();
+                    segment.msgId  = QString("<%1>").arg(xmlReader.text().toString());
+                    nzbFile.segments.append(segment);
+                }
+            }
+            files.append(nzbFile);
+        }
+    }
+
+    if (xmlReader.hasError())
+    {
+        error = QString("parsing error: %1 at line: %2").arg(xmlReader.errorString()).arg(xmlReader.lineNumber());
+        return false;
+    }
+    return true;
+}
+
+int NzbParser::parseParallel(QFile &file, QVector<NzbFile> &files, QString &error, int maxThreads)
+{
+    qint64 size = file.size();
+    int nbThreads = maxThreads > 0 ? maxThreads : QThread::idealThreadCount();
+    nbThreads = static_cast<int>(std::min(static_cast<qint64>(nbThreads), size / sMinChunkSize));
+    uchar *mapped = size >= sParallelMinSize && nbThreads > 1 && size <= std::numeric_limits<int>::max() ? file.map(0, size) : nullptr;
+    if (!mapped)
+        return parse(&file, files, error) ? 1 : -1;
+
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(size));
+    qint64 headEnd = nextFileElement(data, 0);
+    if (headEnd == -1)
+    {
+        file.unmap(mapped);
+        return parse(&file, files, error) ? 1 : -1;
+    }
+
+    // split at the first <file after each share of the file
+    QVector<Chunk> chunks;
+    qint64 begin = headEnd;
+    for (int i = 1; i <= nbThreads && begin < size; ++i)
+    {
+        qint64 end = i == nbThreads ? -1 : nextFileElement(data, headEnd + i * (size - headEnd) / nbThreads);
+        if (end != -1 && end <= begin)
+            continue;
+        if (end == -1)
+            end = size;
+        chunks << Chunk{begin, end, QVector<NzbFile>(), QString(), false};
+        begin = end;
+    }
+
+    // each chunk is a valid nzb: the head, its <file> elements and the end of the root element
+    const QByteArray head = QByteArray::fromRawData(data.constData(), static_cast<int>(headEnd));
+    QList<QFuture<void>> futures;
+    for (Chunk &chunk : chunks)
+    {
+        Chunk *aChunk = &chunk;
+        futures << QtConcurrent::run([aChunk, &data, &head, size]() {
+            // the thread of the pool is in OTHER, the heap is measured by the caller's stage
+            MemoryStage memoryStage(MemoryStats::Stage::PARSE, false);
+            QList<QByteArray> pieces = {head, QByteArray::fromRawData(data.constData() + aChunk->begin,
+                                                                      static_cast<int>(aChunk->end - aChunk->begin))};
+            if (aChunk->end != size)
+                pieces << QByteArray("</nzb>");
+            PiecesDevice device(pieces);
+            aChunk->parsed = parse(&device, aChunk->files, aChunk->error);
+        });
+    }
+    for (QFuture<void> &future : futures)
+        future.waitForFinished();
+    file.unmap(mapped);
+
+    if (!std::all_of(chunks.cbegin(), chunks.cend(), [](const Chunk &chunk) { return chunk.parsed; }))
+    {
+        // parse it again on a single thread for the real line of the error
+        file.seek(0);
+        return parse(&file, files, error) ? 1 : -1;
+    }
+
+    int nbFiles = 0;
+    for (const Chunk &chunk : chunks)
+        nbFiles += chunk.files.size();
+    files.reserve(files.size() + nbFiles);
+    for (Chunk &chunk : chunks)
+    {
+        for (NzbFile &nzbFile : chunk.files)
+            files.append(std::move(nzbFile));
+    }
+    return chunks.size();
+}
+
+int NzbParser::expectedSegments(const QString &subject)
+{
+    QRegularExpressionMatch match = sNntpArticleYencSubjectRegExp.match(subject);
+    if (match.hasMatch())
+        return match.captured(1).toInt();
+    else
+        return 0;
+}
@@ -0,0 +1,78 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NZBPARSER_H
+#define NZBPARSER_H
+
+#include "PureStaticClass.h"
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+class QIODevice;
+class QFile;
+
+struct NzbSegment
+{
+    QString msgId;  //!< message-id with its angle brackets (as used in NNTP commands)
+    qint64  bytes;  //!< bytes attribute of the <segment> (-1 if not provided)
+    int     number; //!< number attribute of the <segment> (0 if not provided)
+};
+
+struct NzbFile
+{
+    QString             subject;
+    qint64              postDate;           //!< date attribute of the <file> (seconds since epoch, 0 if not provided)
+    int                 nbExpectedSegments; //!< from the yEnc subject "(x/N)" (0 if not yEnc)
+    QVector<NzbSegment> segments;
+};
+
+/*!
+ * \brief Pure Static class to parse an nzb into its files and segments
+ * it doesn't depend on NzbCheck so it can be used from any thread
+ */
+class NzbParser : public PureStaticClass
+{
+public:
+    static constexpr const char *sNntpArticleYencSubjectStrRegExp = "^\\[\\d+/\\d+\\]\\s+.+\\(\\d+/(\\d+)\\)$";
+
+    static constexpr qint64 sParallelMinSize = 16 * 1024 * 1024; //!< smaller nzbs are parsed by a single thread (threads would cost more)
+    static constexpr qint64 sMinChunkSize    =  4 * 1024 * 1024; //!< bytes parsed by each thread at least
+
+    //! parse the whole nzb, return false and fill error in case of xml issue
+    static bool parse(QIODevice *device, QVector<NzbFile> &files, QString &error);
+
+    /*!
+     * \brief parse a big nzb on several threads: the file is memory mapped and split at its <file> elements,
+     * the chunks are parsed in parallel (each one behind the head of the nzb) then their files merged in the order of the nzb
+     * small files (or a file that can't be mapped) are given to parse()
+     * \param maxThreads 0 for the number of cores
+     * \return the number of chunks parsed in parallel (1 for the single threaded parse), -1 in case of xml issue
+     */
+    static int parseParallel(QFile &file, QVector<NzbFile> &files, QString &error, int maxThreads = 0);
+
+    //! number of Articles expected from a yEnc subject (0 if the subject is not following yEnc format)
+    static int expectedSegments(const QString &subject);
+
+private:
+    static const QRegularExpression sNntpArticleYencSubjectRegExp;
+};
+
+#endif // NZBPARSER_H
@@ -0,0 +1,124 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbWatcher.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QFileSystemWatcher>
+#if defined(Q_OS_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+NzbWatcher::NzbWatcher(const QString &dirPath, QObject *parent):
+    QObject(parent),
+    _dirPath(QDir(dirPath).absolutePath()),
+    _inotifyFd(-1), _notifier(nullptr), _watcher(nullptr), _knownNzbs()
+{}
+
+NzbWatcher::~NzbWatcher()
+{
+    if (_notifier)
+        delete _notifier;
+#if defined(Q_OS_LINUX)
+    if (_inotifyFd != -1)
+        ::close(_inotifyFd);
+#endif
+    if (_watcher)
+        delete _watcher;
+}
+
+bool NzbWatcher::start(QString &error)
+{
+#if defined(Q_OS_LINUX)
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd == -1)
+    {
+        error = tr("Error initializing inotify: %1").arg(strerror(errno));
+        return false;
+    }
+    // IN_CLOSE_WRITE: written in the folder, IN_MOVED_TO: written elsewhere then renamed in it
+    if (inotify_add_watch(_inotifyFd, QFile::encodeName(_dirPath).constData(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    {
+        error = tr("Error watching %1: %2").arg(_dirPath).arg(strerror(errno));
+        return false;
+    }
+    _notifier = new QSocketNotifier(_inotifyFd, QSocketNotifier::Read);
+    connect(_notifier, SIGNAL(activated(int)), this, SLOT(onInotifyEvents()));
+#else
+    _watcher = new QFileSystemWatcher();
+    if (!_watcher->addPath(_dirPath))
+    {
+        error = tr("Error watching %1").arg(_dirPath);
+        return false;
+    }
+    for (const QString &nzbPath : nzbsInFolder())
+        _knownNzbs.insert(nzbPath);
+    connect(_watcher, &QFileSystemWatcher::directoryChanged, this, &NzbWatcher::onDirectoryChanged);
+#endif
+    return true;
+}
+
+QStringList NzbWatcher::nzbsInFolder() const
+{
+    QStringList nzbPaths;
+    for (const QFileInfo &nzbFile : QDir(_dirPath).entryInfoList({"*.nzb"}, QDir::Files|QDir::Readable, QDir::Time|QDir::Reversed))
+        nzbPaths << nzbFile.absoluteFilePath();
+    return nzbPaths;
+}
+
+void NzbWatcher::onInotifyEvents()
+{
+#if defined(Q_OS_LINUX)
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t len;
+    while ((len = ::read(_inotifyFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *ptr = buffer; ptr < buffer + len; )
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            if (event->len > 0 && !(event->mask & IN_ISDIR))
+            {
+                QString name = QFile::decodeName(event->name);
+                if (name.endsWith(".nzb", Qt::CaseInsensitive))
+                    emit nzbReady(QString("%1/%2").arg(_dirPath).arg(name));
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+void NzbWatcher::onDirectoryChanged()
+{
+    for (const QString &nzbPath : nzbsInFolder())
+    {
+        if (!_knownNzbs.contains(nzbPath))
+        {
+            _knownNzbs.insert(nzbPath);
+            emit nzbReady(nzbPath);
+        }
+    }
+}
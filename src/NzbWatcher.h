@@ -0,0 +1,63 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NZBWATCHER_H
+#define NZBWATCHER_H
+
+#include <QObject>
+#include <QSet>
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+/*!
+ * \brief notify the nzbs dropped in a folder as soon as they're fully written
+ * on Linux it relies on inotify (IN_CLOSE_WRITE / IN_MOVED_TO)
+ * elsewhere it falls back on QFileSystemWatcher (new files are notified as soon as they appear)
+ */
+class NzbWatcher : public QObject
+{
+    Q_OBJECT
+
+private:
+    const QString       _dirPath;
+
+    int                 _inotifyFd;      //!< Linux only
+    QSocketNotifier    *_notifier;       //!< Linux only
+    QFileSystemWatcher *_watcher;        //!< other OS
+    QSet<QString>       _knownNzbs;      //!< other OS: nzbs already in the folder
+
+public:
+    explicit NzbWatcher(const QString &dirPath, QObject *parent = nullptr);
+    ~NzbWatcher();
+
+    bool start(QString &error);
+
+    QStringList nzbsInFolder() const;
+
+signals:
+    void nzbReady(const QString &nzbPath);
+
+private slots:
+    void onInotifyEvents();
+    void onDirectoryChanged();
+};
+
+#endif // NZBWATCHER_H
@@ -0,0 +1,218 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ResultFile.h"
+#include <algorithm>
+
+QVector<ResultFile::Range> ResultFile::missingRanges(const NzbFile &nzbFile, const QSet<QString> &missingArticles)
+{
+    QVector<quint32> numbers;
+    QSet<quint32>    present;
+    for (int i = 0; i < nzbFile.segments.size(); ++i)
+    {
+        const NzbSegment &segment = nzbFile.segments.at(i);
+        quint32 number = static_cast<quint32>(segment.number > 0 ? segment.number : i + 1);
+        present.insert(number);
+        if (missingArticles.contains(segment.msgId))
+            numbers << number;
+    }
+    for (int number = 1; number <= nzbFile.nbExpectedSegments; ++number)
+    {
+        if (!present.contains(static_cast<quint32>(number)))
+            numbers << static_cast<quint32>(number);
+    }
+    return _toRanges(numbers);
+}
+
+QVector<ResultFile::Range> ResultFile::uncheckedRanges(const NzbFile &nzbFile, const QSet<QString> &checkedArticles)
+{
+    QVector<quint32> numbers;
+    for (int i = 0; i < nzbFile.segments.size(); ++i)
+    {
+        const NzbSegment &segment = nzbFile.segments.at(i);
+        if (!checkedArticles.contains(segment.msgId))
+            numbers << static_cast<quint32>(segment.number > 0 ? segment.number : i + 1);
+    }
+    return _toRanges(numbers);
+}
+
+QVector<ResultFile::Range> ResultFile::_toRanges(QVector<quint32> &numbers)
+{
+    std::sort(numbers.begin(), numbers.end());
+
+    QVector<Range> ranges;
+    for (quint32 number : numbers)
+    {
+        if (!ranges.isEmpty() && ranges.last().first + ranges.last().count == number)
+            ++ranges.last().count;
+        else if (ranges.isEmpty() || ranges.last().first + ranges.last().count < number)
+            ranges << Range{number, 1};
+        // else duplicate segment number
+    }
+    return ranges;
+}
+
+bool ResultFile::write(const QString &filePath, const QString &nzbName, int nbArticles, int nbMissing, int nbChecked,
+                       const QVector<FileResult> &files, QString &error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+    {
+        error = QString("Error writing result %1: %2").arg(filePath).arg(file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << sMagic << sVersion << nzbName << static_cast<qint32>(nbArticles) << static_cast<qint32>(nbMissing)
+           << static_cast<qint32>(nbChecked) << static_cast<qint32>(files.size());
+
+    // index: placeholders rewritten once the offsets are known
+    qint64 indexPos = file.pos();
+    for (int i = 0; i < files.size(); ++i)
+        stream << static_cast<quint64>(0) << static_cast<quint32>(0) << static_cast<quint32>(0);
+
+    QVector<quint64> offsets;
+    offsets.reserve(files.size());
+    for (const FileResult &fileResult : files)
+    {
+        offsets << static_cast<quint64>(file.pos());
+        stream << fileResult.subject << fileResult.nbSegments << fileResult.nbExpectedSegments;
+        for (const Range &range : fileResult.missing)
+            stream << range.first << range.count;
+        for (const Range &range : fileResult.unchecked)
+            stream << range.first << range.count;
+    }
+
+    file.seek(indexPos);
+    for (int i = 0; i < files.size(); ++i)
+        stream << offsets.at(i) << static_cast<quint32>(files.at(i).missing.size())
+               << static_cast<quint32>(files.at(i).unchecked.size());
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        error = QString("Error writing result %1: %2").arg(filePath).arg(file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool ResultFile::isResultFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    stream >> magic;
+    return stream.status() == QDataStream::Ok && magic == sMagic;
+}
+
+ResultFile::ResultFile(const QString &filePath):
+    _file(filePath), _stream(), _nzbName(), _nbArticles(0), _nbMissing(0), _nbChecked(0),
+    _offsets(), _nbMissingRanges(), _nbUncheckedRanges()
+{}
+
+bool ResultFile::open(QString &error)
+{
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        error = QString("Error opening the result %1: %2").arg(_file.fileName()).arg(_file.errorString());
+        return false;
+    }
+
+    _stream.setDevice(&_file);
+    _stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32  nbFiles = 0;
+    _stream >> magic >> version;
+    if (_stream.status() != QDataStream::Ok || magic != sMagic || version != sVersion)
+    {
+        error = QString("%1 is not a binary result of nzbCheck (or not of this version)").arg(_file.fileName());
+        return false;
+    }
+    _stream >> _nzbName >> _nbArticles >> _nbMissing >> _nbChecked >> nbFiles;
+    // nbMissing can be above nbArticles: it counts the segments expected from the yEnc subjects but not in the nzb
+    if (_stream.status() != QDataStream::Ok || _nbArticles < 0 || _nbMissing < 0
+            || _nbChecked < 0 || _nbChecked > _nbArticles || nbFiles < 0)
+    {
+        error = QString("The header of the result %1 is corrupted").arg(_file.fileName());
+        return false;
+    }
+
+    // the index and the smallest records (empty subject, no range) must fit in the file
+    qint64 size = _file.size(), indexEnd = _file.pos() + static_cast<qint64>(nbFiles) * sIndexEntrySize;
+    if (indexEnd > size)
+    {
+        error = QString("The index of the result %1 is truncated").arg(_file.fileName());
+        return false;
+    }
+
+    _offsets.resize(nbFiles);
+    _nbMissingRanges.resize(nbFiles);
+    _nbUncheckedRanges.resize(nbFiles);
+    for (int i = 0; i < nbFiles; ++i)
+    {
+        _stream >> _offsets[i] >> _nbMissingRanges[i] >> _nbUncheckedRanges[i];
+        // offset, subject (at least its length), nbSegments, nbExpectedSegments and the ranges
+        qint64 recordSize = 12 + (static_cast<qint64>(_nbMissingRanges.at(i)) + _nbUncheckedRanges.at(i)) * sRangeSize;
+        if (_stream.status() != QDataStream::Ok || _offsets.at(i) < static_cast<quint64>(indexEnd)
+                || _offsets.at(i) > static_cast<quint64>(size) || recordSize > size - static_cast<qint64>(_offsets.at(i)))
+        {
+            error = QString("The index of the result %1 is corrupted (file #%2)").arg(_file.fileName()).arg(i);
+            _offsets.clear();
+            _nbMissingRanges.clear();
+            _nbUncheckedRanges.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ResultFile::file(int index, FileResult &result)
+{
+    if (index < 0 || index >= _offsets.size() || !_file.seek(static_cast<qint64>(_offsets.at(index))))
+        return false;
+
+    _stream.resetStatus();
+    _stream >> result.subject >> result.nbSegments >> result.nbExpectedSegments;
+    if (_stream.status() != QDataStream::Ok || result.nbSegments < 0 || result.nbExpectedSegments < 0)
+        return false;
+    return _readRanges(result.missing, _nbMissingRanges.at(index))
+            && _readRanges(result.unchecked, _nbUncheckedRanges.at(index));
+}
+
+bool ResultFile::_readRanges(QVector<Range> &ranges, quint32 nbRanges)
+{
+    // open checked the counts with an empty subject: check again after the real one
+    if (static_cast<qint64>(nbRanges) * sRangeSize > _file.size() - _file.pos())
+        return false;
+
+    ranges.resize(static_cast<int>(nbRanges));
+    for (Range &range : ranges)
+    {
+        _stream >> range.first >> range.count;
+        if (range.first == 0 || range.count == 0 || range.first + range.count < range.first) // numbers start at 1, no overflow
+            return false;
+    }
+    return _stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,113 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef RESULTFILE_H
+#define RESULTFILE_H
+
+#include <QString>
+#include <QVector>
+#include <QSet>
+#include <QFile>
+#include <QDataStream>
+#include "NzbParser.h"
+
+/*!
+ * \brief compact binary result of a check (--result-format bin), written by NzbCheck and read back with this class
+ * the missing Articles of each file are ranges of segment numbers (run-length) instead of their message-ids
+ * the segments that were not checked (--deadline, connections lost) are ranges too: they're neither missing nor present
+ * format (QDataStream): header (sMagic, sVersion, nzb name, nbArticles, nbMissing, nbChecked, nbFiles),
+ * index (offset, number of missing and of unchecked ranges of each file record: fixed size so a file is read without the others)
+ * then the file records (subject, nbSegments, nbExpectedSegments, missing ranges, unchecked ranges)
+ * writing and reading a file are O(ranges), a dead post is a single range per file
+ * a truncated or corrupted file is refused by open or file (the index and the ranges are checked against the file size)
+ */
+class ResultFile
+{
+public:
+    struct Range {
+        quint32 first; //!< segment number
+        quint32 count;
+    };
+    struct FileResult {
+        QString        subject;
+        qint32         nbSegments;         //!< in the nzb
+        qint32         nbExpectedSegments; //!< from the yEnc subject (0 if not yEnc)
+        QVector<Range> missing;
+        QVector<Range> unchecked;          //!< segments of the nzb that were not checked
+    };
+
+    static const quint32 sMagic   = 0x4e5a4252; //!< "NZBR"
+    static const quint16 sVersion = 2;          //!< 2: unchecked ranges and nbChecked
+
+    //! ranges of the missing segments of the file: the missing Articles and the numbers expected but not in the nzb
+    //! (the position in the file is used for the segments without number)
+    static QVector<Range> missingRanges(const NzbFile &nzbFile, const QSet<QString> &missingArticles);
+    //! ranges of the segments of the file that are not in checkedArticles
+    static QVector<Range> uncheckedRanges(const NzbFile &nzbFile, const QSet<QString> &checkedArticles);
+
+    static bool write(const QString &filePath, const QString &nzbName, int nbArticles, int nbMissing, int nbChecked,
+                      const QVector<FileResult> &files, QString &error);
+
+    //! the file starts with sMagic (to tell it from a json result)
+    static bool isResultFile(const QString &filePath);
+
+    explicit ResultFile(const QString &filePath);
+    ~ResultFile() = default;
+
+    ResultFile(const ResultFile &other) = delete;
+    ResultFile & operator=(const ResultFile &other) = delete;
+
+    //! read the header and the index only
+    bool open(QString &error);
+    //! read the record of one file (index in the nzb), false if it is out of the file or corrupted
+    bool file(int index, FileResult &result);
+
+    inline const QString &nzbName() const;
+    inline int nbArticles() const;
+    inline int nbMissing() const;
+    inline int nbChecked() const;
+    inline int nbFiles() const;
+
+private:
+    QFile            _file;
+    QDataStream      _stream;
+    QString          _nzbName;
+    qint32           _nbArticles;
+    qint32           _nbMissing;
+    qint32           _nbChecked;
+    QVector<quint64> _offsets;  //!< of the file records
+    QVector<quint32> _nbMissingRanges;
+    QVector<quint32> _nbUncheckedRanges;
+
+    static const int sIndexEntrySize = 16; //!< offset (8), nbMissingRanges (4), nbUncheckedRanges (4)
+    static const int sRangeSize      = 8;  //!< first (4), count (4)
+
+    static QVector<Range> _toRanges(QVector<quint32> &numbers);
+    bool _readRanges(QVector<Range> &ranges, quint32 nbRanges);
+};
+
+const QString &ResultFile::nzbName() const { return _nzbName; }
+int ResultFile::nbArticles() const { return _nbArticles; }
+int ResultFile::nbMissing() const { return _nbMissing; }
+int ResultFile::nbChecked() const { return _nbChecked; }
+int ResultFile::nbFiles() const { return _offsets.size(); }
+
+#endif // RESULTFILE_H
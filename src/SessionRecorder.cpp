@@ -0,0 +1,58 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "SessionRecorder.h"
+#include "NntpServerParams.h"
+
+SessionRecorder::SessionRecorder(const QString &filePath, const QList<NntpServerParams*> &servers):
+    _file(filePath), _stream(), _servers(servers), _srvIndexes(), _clock()
+{
+    for (int i = 0; i < _servers.size(); ++i)
+        _srvIndexes.insert(_servers.at(i), static_cast<qint16>(i));
+}
+
+bool SessionRecorder::open(QString &error)
+{
+    if (!_file.open(QIODevice::WriteOnly))
+    {
+        error = QString("Error opening the record file %1: %2").arg(_file.fileName()).arg(_file.errorString());
+        return false;
+    }
+
+    _stream.setDevice(&_file);
+    _stream.setVersion(QDataStream::Qt_5_0);
+    _stream << sMagic << sVersion << static_cast<qint32>(_servers.size());
+    for (const NntpServerParams *srvParams : _servers)
+        _stream << srvParams->host << srvParams->port << static_cast<qint32>(srvParams->nbCons)
+                << srvParams->useSSL << !srvParams->user.empty();
+    _clock.start();
+    return true;
+}
+
+void SessionRecorder::add(const NntpServerParams &srvParams, int conId, Event event, const QByteArray &data)
+{
+    _stream << _clock.nsecsElapsed() << _srvIndexes.value(&srvParams, -1) << static_cast<qint16>(conId)
+            << static_cast<quint8>(event);
+    if (event == Event::SENT && data.startsWith("authinfo "))
+        _stream << data.left(data.indexOf(' ', 9)) + " ***\r\n"; // no credentials
+    else
+        _stream << data;
+}
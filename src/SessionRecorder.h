@@ -0,0 +1,66 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef SESSIONRECORDER_H
+#define SESSIONRECORDER_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+struct NntpServerParams;
+
+/*!
+ * \brief records the exchanges of all the NntpCon of a run (--record)
+ * so they can be replayed without network by SessionReplay
+ * format (QDataStream): header (sMagic, sVersion, servers) then the events
+ * (ns since the start, server index, connection id, Event, data)
+ * the credentials are not recorded
+ */
+class SessionRecorder
+{
+public:
+    enum class Event : quint8 {CONNECTING = 0, CONNECTED, ENCRYPTED, SENT, RECEIVED, DISCONNECTED};
+
+    static const quint32 sMagic   = 0x4e5a4253; //!< "NZBS"
+    static const quint16 sVersion = 1;
+
+    SessionRecorder(const QString &filePath, const QList<NntpServerParams*> &servers);
+    ~SessionRecorder() = default;
+
+    SessionRecorder(const SessionRecorder &other) = delete;
+    SessionRecorder & operator=(const SessionRecorder &other) = delete;
+
+    bool open(QString &error);
+
+    void add(const NntpServerParams &srvParams, int conId, Event event, const QByteArray &data = QByteArray());
+
+private:
+    QFile                                 _file;
+    QDataStream                           _stream;
+    const QList<NntpServerParams*>        _servers;
+    QHash<const NntpServerParams*, qint16> _srvIndexes;
+    QElapsedTimer                         _clock;
+};
+
+#endif // SESSIONRECORDER_H
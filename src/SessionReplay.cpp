@@ -0,0 +1,288 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "SessionReplay.h"
+#include "SessionRecorder.h"
+#include "NntpServerParams.h"
+#include <QFile>
+#include <QDataStream>
+#include <QTimer>
+#include <algorithm>
+
+SessionReplay::SessionReplay(double speed):
+    _speed(speed), _cons(), _statReplies(), _nbExchanges(0)
+{}
+
+SessionReplay::~SessionReplay() = default;
+
+bool SessionReplay::load(const QString &filePath, QList<NntpServerParams*> &servers, QString &error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        error = QString("Error opening the record %1: %2").arg(filePath).arg(file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32  nbServers = 0;
+    stream >> magic >> version >> nbServers;
+    if (magic != SessionRecorder::sMagic || version != SessionRecorder::sVersion || nbServers <= 0)
+    {
+        error = QString("Error: %1 is not a session record (--record)").arg(filePath);
+        return false;
+    }
+
+    for (int i = 0; i < nbServers; ++i)
+    {
+        QString host;
+        quint16 port;
+        qint32  nbCons;
+        bool    useSSL, auth;
+        stream >> host >> port >> nbCons >> useSSL >> auth;
+        // the TLS handshake is part of the recorded connect delay
+        servers << new NntpServerParams(host, port, auth, auth ? "replay" : "", auth ? "replay" : "", nbCons, false);
+    }
+    _statReplies.resize(nbServers);
+
+    while (!stream.atEnd())
+    {
+        qint64     time;
+        qint16     srvIndex, conId;
+        quint8     event;
+        QByteArray data;
+        stream >> time >> srvIndex >> conId >> event >> data;
+        if (stream.status() != QDataStream::Ok)
+            break; // truncated record (the run was killed)
+        if (srvIndex < 0 || srvIndex >= nbServers)
+            continue;
+
+        // reconnections are not replayed: we keep the first session of each connection
+        RecordedCon &con = _cons[_conKey(srvIndex, conId)];
+        switch (static_cast<SessionRecorder::Event>(event))
+        {
+        case SessionRecorder::Event::CONNECTING:
+            if (con.welcome.isEmpty())
+                con.startTime = time;
+            break;
+        case SessionRecorder::Event::CONNECTED:
+        case SessionRecorder::Event::ENCRYPTED:
+            if (con.welcome.isEmpty())
+                con.connectDelay = time - con.startTime;
+            break;
+        case SessionRecorder::Event::SENT:
+            con.exchanges.append({data, QByteArray(), time, 0});
+            con.waitingReplies.append(static_cast<int>(con.exchanges.size()) - 1);
+            break;
+        case SessionRecorder::Event::RECEIVED:
+            if (con.welcome.isEmpty() && con.exchanges.isEmpty())
+            {
+                con.welcome      = data;
+                con.welcomeDelay = time - con.startTime - con.connectDelay;
+            }
+            else if (!con.waitingReplies.isEmpty())
+            {
+                // replies come in order (pipelining)
+                Exchange &exchange = con.exchanges[con.waitingReplies.takeFirst()];
+                exchange.reply   = data;
+                exchange.latency = time - exchange.sentTime;
+                if (exchange.command.startsWith("stat "))
+                    _statReplies[srvIndex].insert(exchange.command.mid(5).trimmed(), data);
+                ++_nbExchanges;
+            }
+            break;
+        case SessionRecorder::Event::DISCONNECTED:
+            con.waitingReplies.clear(); // those replies are lost
+            break;
+        }
+    }
+
+    for (RecordedCon &con : _cons)
+    {
+        con.waitingReplies.clear();
+        con.exchanges.erase(std::remove_if(con.exchanges.begin(), con.exchanges.end(),
+                                           [](const Exchange &exchange) { return exchange.reply.isEmpty(); }),
+                            con.exchanges.end());
+    }
+
+    if (_nbExchanges == 0)
+    {
+        error = QString("Error: no exchange in the record %1").arg(filePath);
+        return false;
+    }
+    return true;
+}
+
+QTcpSocket *SessionReplay::newSocket(int srvIndex, int conId)
+{
+    static const RecordedCon sNotRecorded;
+    const RecordedCon *con = &sNotRecorded;
+    auto it = _cons.constFind(_conKey(srvIndex, conId));
+    if (it != _cons.cend())
+        con = &it.value();
+    else
+    {
+        // more connections than recorded: replay the first one of the server
+        for (it = _cons.cbegin(); it != _cons.cend(); ++it)
+        {
+            if (static_cast<int>(it.key() >> 16) == srvIndex)
+            {
+                con = &it.value();
+                break;
+            }
+        }
+    }
+    return new NntpReplaySocket(*this, *con, _statReplies.at(srvIndex));
+}
+
+
+NntpReplaySocket::NntpReplaySocket(const SessionReplay &replay, const SessionReplay::RecordedCon &con,
+                                   const QHash<QByteArray, QByteArray> &statReplies):
+    QTcpSocket(),
+    _replay(replay), _con(con), _statReplies(statReplies),
+    _clock(), _lastDelivery(0), _command(), _received(), _nbCommands(0)
+{
+    _clock.start();
+}
+
+NntpReplaySocket::~NntpReplaySocket()
+{
+    setSocketState(UnconnectedState); // nothing for QAbstractSocket to abort
+}
+
+void NntpReplaySocket::connectToHost(const QString &hostName, quint16 port,
+                                     OpenMode openMode, NetworkLayerProtocol protocol)
+{
+    Q_UNUSED(hostName);
+    Q_UNUSED(port);
+    Q_UNUSED(protocol);
+
+    setSocketState(ConnectingState);
+    if (_con.welcome.isEmpty())
+    {
+        setSocketError(ConnectionRefusedError);
+        setErrorString(tr("connection not in the record"));
+        QTimer::singleShot(0, this, [this](){ emit error(ConnectionRefusedError); });
+        return;
+    }
+
+    setOpenMode(openMode | Unbuffered);
+    qint64 connectDelay = _replay.speed() > 0. ? static_cast<qint64>(_con.connectDelay / _replay.speed()) : 0;
+    QTimer::singleShot(static_cast<int>(connectDelay / 1000000), Qt::PreciseTimer, this, [this](){
+        setSocketState(ConnectedState);
+        _lastDelivery = _clock.nsecsElapsed();
+        emit connected();
+        _deliver(_con.welcomeDelay, _con.welcome);
+    });
+}
+
+void NntpReplaySocket::disconnectFromHost()
+{
+    if (state() == UnconnectedState)
+        return;
+
+    setSocketState(UnconnectedState);
+    setOpenMode(NotOpen);
+    QTimer::singleShot(0, this, [this](){ emit disconnected(); });
+}
+
+bool NntpReplaySocket::waitForDisconnected(int msecs)
+{
+    Q_UNUSED(msecs);
+    return true;
+}
+
+qint64 NntpReplaySocket::bytesAvailable() const
+{
+    return _received.size();
+}
+
+bool NntpReplaySocket::canReadLine() const
+{
+    return _received.contains('\n');
+}
+
+qint64 NntpReplaySocket::readData(char *data, qint64 maxlen)
+{
+    int size = static_cast<int>(std::min(maxlen, static_cast<qint64>(_received.size())));
+    memcpy(data, _received.constData(), static_cast<size_t>(size));
+    _received.remove(0, size);
+    return size;
+}
+
+qint64 NntpReplaySocket::readLineData(char *data, qint64 maxlen)
+{
+    int end  = _received.indexOf('\n');
+    int size = end < 0 ? _received.size() : end + 1;
+    size = static_cast<int>(std::min(maxlen, static_cast<qint64>(size)));
+    memcpy(data, _received.constData(), static_cast<size_t>(size));
+    _received.remove(0, size);
+    return size;
+}
+
+qint64 NntpReplaySocket::writeData(const char *data, qint64 len)
+{
+    _command.append(data, static_cast<int>(len));
+    int end;
+    while ((end = _command.indexOf('\n')) >= 0)
+    {
+        _reply(_command.left(end + 1));
+        _command.remove(0, end + 1);
+    }
+    return len;
+}
+
+void NntpReplaySocket::_reply(const QByteArray &command)
+{
+    // the latencies (and the replies other than STAT) follow the recorded connection
+    qint64     latency = 0;
+    QByteArray reply("502 not in the record\r\n");
+    if (!_con.exchanges.isEmpty())
+    {
+        const SessionReplay::Exchange &exchange = _con.exchanges.at(_nbCommands++ % _con.exchanges.size());
+        latency = exchange.latency;
+        reply   = exchange.reply;
+    }
+    if (command.startsWith("stat "))
+        reply = _statReplies.value(command.mid(5).trimmed(), QByteArray("430 not in the record\r\n"));
+
+    _deliver(latency, reply);
+}
+
+void NntpReplaySocket::_deliver(qint64 delay, const QByteArray &reply)
+{
+    // each reply after its latency but never before the previous one
+    qint64 now = _clock.nsecsElapsed();
+    if (_replay.speed() > 0.)
+        _lastDelivery = std::max(_lastDelivery, now + static_cast<qint64>(delay / _replay.speed()));
+    else
+        _lastDelivery = std::max(_lastDelivery, now);
+
+    QTimer::singleShot(static_cast<int>((_lastDelivery - now) / 1000000), Qt::PreciseTimer, this, [this, reply](){
+        if (state() != ConnectedState)
+            return;
+        _received += reply;
+        emit readyRead();
+    });
+}
@@ -0,0 +1,133 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include <QTcpSocket>
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+struct NntpServerParams;
+
+/*!
+ * \brief a recorded session (SessionRecorder) loaded to be replayed (--replay)
+ * for each connection we keep its connect and welcome delays and its exchanges
+ * (command, reply, latency), for each server the replies of the STAT by message-id
+ */
+class SessionReplay
+{
+public:
+    struct Exchange {
+        QByteArray command;
+        QByteArray reply;
+        qint64     sentTime; //!< ns since the start of the record
+        qint64     latency;  //!< ns between the command and its reply
+    };
+
+    struct RecordedCon {
+        qint64            startTime;    //!< ns since the start of the record
+        qint64            connectDelay; //!< ns to be connected (TLS handshake included)
+        qint64            welcomeDelay; //!< ns from connected to the welcome line
+        QByteArray        welcome;
+        QVector<Exchange> exchanges;
+        QList<int>        waitingReplies; //!< exchanges sent but not replied yet (while loading)
+
+        RecordedCon() : startTime(0), connectDelay(0), welcomeDelay(0), welcome(),
+            exchanges(), waitingReplies() {}
+    };
+
+    explicit SessionReplay(double speed);
+    ~SessionReplay();
+
+    SessionReplay(const SessionReplay &other) = delete;
+    SessionReplay & operator=(const SessionReplay &other) = delete;
+
+    //! load a record, the servers are the ones of the recorded run (no SSL, fake credentials)
+    bool load(const QString &filePath, QList<NntpServerParams*> &servers, QString &error);
+
+    //! socket replaying the connection conId of the server srvIndex
+    QTcpSocket *newSocket(int srvIndex, int conId);
+
+    inline double speed() const;
+    inline int nbExchanges() const;
+
+private:
+    const double                          _speed; //!< 2 = twice as fast as recorded, 0 = no delay
+    QHash<quint32, RecordedCon>           _cons;  //!< key: srvIndex << 16 | conId
+    QVector<QHash<QByteArray, QByteArray>> _statReplies; //!< by server: reply of each message-id
+    int                                   _nbExchanges;
+
+    static inline quint32 _conKey(int srvIndex, int conId);
+
+    friend class NntpReplaySocket;
+};
+
+/*!
+ * \brief QTcpSocket feeding a RecordedCon back to the NntpCon state machine
+ * with the recorded latencies (divided by the replay speed), no network involved.
+ * a STAT is answered with the recorded reply for its message-id (on the same server)
+ * so the replay stays right even if the scheduler spreads the Articles differently
+ */
+class NntpReplaySocket : public QTcpSocket
+{
+    Q_OBJECT
+
+public:
+    NntpReplaySocket(const SessionReplay &replay, const SessionReplay::RecordedCon &con,
+                     const QHash<QByteArray, QByteArray> &statReplies);
+    ~NntpReplaySocket() override;
+
+    using QTcpSocket::connectToHost;
+    void connectToHost(const QString &hostName, quint16 port,
+                       OpenMode openMode = ReadWrite, NetworkLayerProtocol protocol = AnyIPProtocol) override;
+    void disconnectFromHost() override;
+    bool waitForDisconnected(int msecs = 30000) override;
+
+    qint64 bytesAvailable() const override;
+    bool canReadLine() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 readLineData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    const SessionReplay                   &_replay;
+    const SessionReplay::RecordedCon      &_con;
+    const QHash<QByteArray, QByteArray>   &_statReplies;
+    QElapsedTimer                          _clock;
+    qint64                                 _lastDelivery; //!< ns on _clock, replies are delivered in order
+    QByteArray                             _command;      //!< partial command written
+    QByteArray                             _received;     //!< replies delivered, not read yet
+    int                                    _nbCommands;
+
+    void _deliver(qint64 delay, const QByteArray &reply);
+    void _reply(const QByteArray &command);
+};
+
+double SessionReplay::speed() const { return _speed; }
+int SessionReplay::nbExchanges() const { return _nbExchanges; }
+quint32 SessionReplay::_conKey(int srvIndex, int conId) { return static_cast<quint32>(srvIndex) << 16 | static_cast<quint16>(conId); }
+
+#endif // SESSIONREPLAY_H
@@ -0,0 +1,178 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ShardCoordinator.h"
+#include "NzbCheck.h"
+#include <QTcpSocket>
+
+ShardCoordinator::ShardCoordinator(NzbCheck *nzbCheck, NzbJob *job)
+    : QObject(),
+      _nzbCheck(nzbCheck), _job(job), _server(), _workers(), _lastHeard(), _livenessTimer(), _lastRangeId(0)
+{
+    connect(&_server,        &QTcpServer::newConnection, this, &ShardCoordinator::onNewConnection);
+    connect(&_livenessTimer, &QTimer::timeout,           this, &ShardCoordinator::onLivenessTimer);
+    _livenessTimer.start(sHeartbeatPeriod);
+}
+
+ShardCoordinator::~ShardCoordinator()
+{
+    // the job may be gone: we don't want to hear from the workers anymore
+    for (QTcpSocket *worker : _workers.keys())
+    {
+        worker->disconnect(this);
+        worker->abort();
+        delete worker;
+    }
+}
+
+bool ShardCoordinator::listen(ushort port, QString &error)
+{
+    if (_server.listen(QHostAddress::Any, port))
+        return true;
+    error = tr("Error listening on port %1: %2").arg(port).arg(_server.errorString());
+    return false;
+}
+
+void ShardCoordinator::onNewConnection()
+{
+    while (QTcpSocket *worker = _server.nextPendingConnection())
+    {
+        worker->setParent(nullptr); // we delete them ourselves
+        worker->setObjectName(QString("%1:%2").arg(worker->peerAddress().toString()).arg(worker->peerPort()));
+        connect(worker, &QIODevice::readyRead, this, &ShardCoordinator::onWorkerReadyRead);
+        connect(worker, &QAbstractSocket::disconnected, this, &ShardCoordinator::onWorkerDisconnected);
+        _workers.insert(worker, QList<Range>());
+        _lastHeard[worker].start();
+        if (_nzbCheck->debugMode())
+            _nzbCheck->log(tr("Worker %1 connected (%2 worker(s))").arg(worker->objectName()).arg(_workers.size()));
+        _giveRanges(worker);
+    }
+}
+
+void ShardCoordinator::onWorkerReadyRead()
+{
+    QTcpSocket *worker = static_cast<QTcpSocket*>(sender());
+    _lastHeard[worker].start();
+    while (worker->canReadLine())
+    {
+        QList<QByteArray> fields = worker->readLine().trimmed().split(' ');
+        bool ok = false;
+        int rangeId = fields.size() > 1 ? fields.at(1).toInt(&ok) : 0;
+        if (!ok)
+            continue;
+
+        if (fields.first() == "MISSING" && fields.size() == 3)
+        {
+            for (Range &range : _workers[worker])
+            {
+                if (range.id == rangeId)
+                    range.missing.insert(QString::fromLatin1(fields.at(2)));
+            }
+        }
+        else if (fields.first() == "DONE")
+            _rangeDone(worker, rangeId);
+    }
+}
+
+void ShardCoordinator::_rangeDone(QTcpSocket *worker, int rangeId)
+{
+    QList<Range> &ranges = _workers[worker];
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges.at(i).id == rangeId)
+        {
+            Range range = ranges.takeAt(i);
+            _giveRanges(worker); // before the last articleChecked that may finish the check
+            for (const QString &article : range.articles)
+                _nzbCheck->articleChecked(_job, article, range.missing.contains(article));
+            return;
+        }
+    }
+}
+
+void ShardCoordinator::onWorkerDisconnected()
+{
+    _loseWorker(static_cast<QTcpSocket*>(sender()), tr("lost"));
+}
+
+void ShardCoordinator::onLivenessTimer()
+{
+    for (QTcpSocket *worker : _workers.keys())
+    {
+        if (_workers.value(worker).isEmpty() || _lastHeard.value(worker).elapsed() < sWorkerTimeout)
+            continue;
+        // hung: it may come back, we won't listen to it
+        worker->disconnect(this);
+        worker->abort();
+        _loseWorker(worker, tr("silent for %1 ms").arg(_lastHeard.value(worker).elapsed()));
+    }
+}
+
+void ShardCoordinator::_loseWorker(QTcpSocket *worker, const QString &reason)
+{
+    QList<Range> ranges = _workers.take(worker);
+    _lastHeard.remove(worker);
+    worker->deleteLater();
+
+    int nbArticles = 0;
+    for (const Range &range : ranges)
+    {
+        for (const QString &article : range.articles)
+            _nzbCheck->articleNotChecked(_job, article);
+        nbArticles += range.articles.size();
+    }
+    if (nbArticles)
+        _nzbCheck->error(tr("Worker %1 %2, %3 Article(s) given to the others (%4 worker(s) left)").arg(
+                             worker->objectName()).arg(reason).arg(nbArticles).arg(_workers.size()));
+    else if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("Worker %1 disconnected (%2 worker(s) left)").arg(worker->objectName()).arg(_workers.size()));
+
+    for (QTcpSocket *other : _workers.keys())
+        _giveRanges(other);
+}
+
+void ShardCoordinator::_giveRanges(QTcpSocket *worker)
+{
+    QList<Range> &ranges = _workers[worker];
+    while (ranges.size() < sRangesPerWorker && _job->nbQueuedArticles() > 0)
+    {
+        Range range{++_lastRangeId, QStringList(), QSet<QString>()};
+        QByteArray cmd = QByteArray("RANGE ") + QByteArray::number(range.id);
+        int lastAge = 0;
+        for (int i = 0; i < sRangeSize; ++i)
+        {
+            QString article = _nzbCheck->takeArticle(_job); // aged ones included, the oldest first
+            if (article.isEmpty())
+                break;
+            ++_job->nbPendingArticles;
+            range.articles << article;
+            int ageDays = _job->articleAges.value(article, 0);
+            if (ageDays != lastAge)
+            {
+                cmd += " @" + QByteArray::number(ageDays);
+                lastAge = ageDays;
+            }
+            cmd += ' ' + article.toLatin1();
+        }
+        worker->write(cmd + '\n');
+        ranges << range;
+    }
+}
@@ -0,0 +1,95 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef SHARDCOORDINATOR_H
+#define SHARDCOORDINATOR_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QElapsedTimer>
+class NzbCheck;
+struct NzbJob;
+class QTcpSocket;
+
+/*!
+ * \brief hands ranges of Articles of a parsed nzb to nzbcheck workers over TCP (--coordinator)
+ * line protocol (the message-ids have no space):
+ *   coordinator -> worker: RANGE <rangeId> <msgId> <msgId>... @<ageDays> <msgId>...
+ *                          (the msgIds following @<ageDays> are that old: the worker applies the retention of its servers)
+ *   worker -> coordinator: MISSING <rangeId> <msgId>  (as soon as it is known)
+ *                          DONE <rangeId>             (the whole range is checked)
+ *                          ALIVE                      (every sHeartbeatPeriod)
+ * the results of a range are only given to NzbCheck when it is DONE
+ * so the ranges of a lost worker are given back entirely to the others,
+ * a worker that we don't hear from for sWorkerTimeout (hung, network down) is dropped the same way
+ */
+class ShardCoordinator : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Range {
+        int           id;
+        QStringList   articles;
+        QSet<QString> missing;
+    };
+
+    NzbCheck *const  _nzbCheck;
+    NzbJob   *const  _job;
+    QTcpServer       _server;
+    QHash<QTcpSocket*, QList<Range>> _workers; //!< ranges in flight per worker
+    QHash<QTcpSocket*, QElapsedTimer> _lastHeard; //!< last line received from each worker
+    QTimer           _livenessTimer;
+    int              _lastRangeId;
+
+    static const int sRangeSize       = 500; //!< Articles per range
+    static const int sRangesPerWorker = 2;   //!< so a worker has the next range while finishing the current one
+    static const int sWorkerTimeout   = 10000; //!< ms without any line from a worker before giving its ranges to the others
+
+public:
+    static const int sHeartbeatPeriod = 2000; //!< ms between two ALIVE of a worker (ShardWorker)
+
+    ShardCoordinator(NzbCheck *nzbCheck, NzbJob *job);
+    ~ShardCoordinator();
+
+    bool listen(ushort port, QString &error);
+
+    inline int nbWorkers() const;
+
+private slots:
+    void onNewConnection();
+    void onWorkerReadyRead();
+    void onWorkerDisconnected();
+    void onLivenessTimer();
+
+private:
+    void _loseWorker(QTcpSocket *worker, const QString &reason);
+    void _giveRanges(QTcpSocket *worker);
+    void _rangeDone(QTcpSocket *worker, int rangeId);
+};
+
+int ShardCoordinator::nbWorkers() const { return _workers.size(); }
+
+#endif // SHARDCOORDINATOR_H
@@ -0,0 +1,124 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ShardWorker.h"
+#include "NzbCheck.h"
+#include "ShardCoordinator.h"
+#include "NntpServerParams.h"
+#include <QDateTime>
+
+ShardWorker::ShardWorker(NzbCheck *nzbCheck, const QString &host, ushort port)
+    : QObject(),
+      _nzbCheck(nzbCheck), _host(host), _port(port), _socket(), _ranges(), _heartbeatTimer()
+{
+    connect(&_heartbeatTimer, &QTimer::timeout, this, [this](){ _socket.write("ALIVE\n"); });
+    connect(&_socket, &QAbstractSocket::connected,    this, &ShardWorker::onConnected);
+    connect(&_socket, &QIODevice::readyRead,          this, &ShardWorker::onReadyRead);
+    connect(&_socket, &QAbstractSocket::disconnected, this, &ShardWorker::onDisconnected);
+    connect(&_socket, SIGNAL(error(QAbstractSocket::SocketError)),
+            this,     SLOT(onError(QAbstractSocket::SocketError)));
+
+    connect(_nzbCheck, &NzbCheck::articleResult, this, &ShardWorker::onArticleResult);
+    connect(_nzbCheck, &NzbCheck::jobFinished,   this, &ShardWorker::onJobFinished);
+}
+
+void ShardWorker::start()
+{
+    _socket.connectToHost(_host, _port);
+}
+
+void ShardWorker::onConnected()
+{
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("Connected to the coordinator %1:%2").arg(_host).arg(_port));
+    _heartbeatTimer.start(ShardCoordinator::sHeartbeatPeriod);
+}
+
+void ShardWorker::onReadyRead()
+{
+    while (_socket.canReadLine())
+    {
+        QList<QByteArray> fields = _socket.readLine().trimmed().split(' ');
+        if (fields.size() < 3 || fields.first() != "RANGE")
+            continue;
+
+        // one file per age (its post date) so our servers only check what they keep,
+        // the Articles beyond the retention of all of them are missing straight away
+        int rangeId = fields.at(1).toInt();
+        QString name = QString("range %1").arg(rangeId);
+        QVector<NzbFile> files;
+        qint64 now = QDateTime::currentSecsSinceEpoch();
+        bool expired = false;
+        for (int i = 2; i < fields.size(); ++i)
+        {
+            const QByteArray &field = fields.at(i);
+            if (field.startsWith('@'))
+            {
+                int ageDays = field.mid(1).toInt();
+                expired     = _nzbCheck->isExpired(ageDays);
+                if (!expired) // half a day younger so the age in days is the same
+                    files.append({name, ageDays ? now - ageDays * NntpServerParams::sSecondsPerDay - NntpServerParams::sSecondsPerDay / 2 : 0,
+                                  0, QVector<NzbSegment>()});
+            }
+            else if (expired)
+                _socket.write(QString("MISSING %1 %2\n").arg(rangeId).arg(QString::fromLatin1(field)).toLatin1());
+            else
+            {
+                if (files.isEmpty())
+                    files.append({name, 0, 0, QVector<NzbSegment>()});
+                files.last().segments.append({QString::fromLatin1(field), -1, 0});
+            }
+        }
+        if (files.isEmpty())
+            _socket.write(QString("DONE %1\n").arg(rangeId).toLatin1()); // all expired
+        else
+            _ranges.insert(_nzbCheck->checkSegments(name, files), rangeId);
+    }
+}
+
+void ShardWorker::onArticleResult(int jobId, const QString &msgId, bool missing)
+{
+    if (missing && _ranges.contains(jobId))
+        _socket.write(QString("MISSING %1 %2\n").arg(_ranges.value(jobId)).arg(msgId).toLatin1());
+}
+
+void ShardWorker::onJobFinished(int jobId)
+{
+    if (_ranges.contains(jobId))
+        _socket.write(QString("DONE %1\n").arg(_ranges.take(jobId)).toLatin1());
+}
+
+void ShardWorker::onDisconnected()
+{
+    if (_nzbCheck->debugMode())
+        _nzbCheck->log(tr("The coordinator closed the connection"));
+    _heartbeatTimer.stop();
+    emit finished();
+}
+
+void ShardWorker::onError(QAbstractSocket::SocketError socketError)
+{
+    if (socketError == QAbstractSocket::RemoteHostClosedError)
+        return; // onDisconnected
+    _nzbCheck->error(tr("Coordinator %1:%2: %3").arg(_host).arg(_port).arg(_socket.errorString()));
+    if (_socket.state() != QAbstractSocket::ConnectedState)
+        emit finished(); // disconnected won't come if we were never connected
+}
@@ -0,0 +1,66 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef SHARDWORKER_H
+#define SHARDWORKER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QHash>
+#include <QTimer>
+class NzbCheck;
+
+/*!
+ * \brief checks the ranges of Articles given by a ShardCoordinator (--worker)
+ * each range is a job of the NzbCheck pool, its missing Articles are streamed back
+ * as soon as they're known and DONE is sent when the job is finished (cf ShardCoordinator protocol)
+ */
+class ShardWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    NzbCheck *const _nzbCheck;
+    const QString   _host;
+    const ushort    _port;
+    QTcpSocket      _socket;
+    QHash<int, int> _ranges; //!< rangeId per jobId of the NzbCheck pool
+    QTimer          _heartbeatTimer; //!< ALIVE to the coordinator so it doesn't take our ranges back
+
+public:
+    ShardWorker(NzbCheck *nzbCheck, const QString &host, ushort port);
+
+    void start();
+
+signals:
+    void finished(); //!< the coordinator is gone (check done or lost)
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onDisconnected();
+    void onError(QAbstractSocket::SocketError);
+
+    void onArticleResult(int jobId, const QString &msgId, bool missing);
+    void onJobFinished(int jobId);
+};
+
+#endif // SHARDWORKER_H
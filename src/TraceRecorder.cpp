@@ -0,0 +1,94 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "TraceRecorder.h"
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+TraceBuffer::TraceBuffer(const QElapsedTimer &clock, int tid, const QString &name, int capacity):
+    _clock(clock), _tid(tid), _name(name), _capacity(std::max(capacity, 1)), _spans(), _next(0), _nbDropped(0)
+{
+    _spans.reserve(_capacity);
+}
+
+TraceRecorder::TraceRecorder(const QString &filePath):
+    _filePath(filePath), _clock(), _buffers()
+{
+    _clock.start();
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    qDeleteAll(_buffers);
+}
+
+TraceBuffer *TraceRecorder::newBuffer(const QString &name, int capacity)
+{
+    TraceBuffer *buffer = new TraceBuffer(_clock, _buffers.size(), name, capacity);
+    _buffers << buffer;
+    return buffer;
+}
+
+bool TraceRecorder::write(QString &error) const
+{
+    QFile file(_filePath);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Text))
+    {
+        error = QString("Error opening trace file %1: %2").arg(_filePath).arg(file.errorString());
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (TraceBuffer *buffer : _buffers)
+    {
+        QString name(buffer->_name);
+        if (buffer->_nbDropped)
+            name += QString(" (%1 oldest spans dropped)").arg(buffer->_nbDropped);
+        name.replace("\\", "\\\\").replace("\"", "\\\"");
+        stream << (first ? "" : ",\n")
+               << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,\"args\":{\"name\":\"%2\"}}").arg(
+                      buffer->_tid).arg(name);
+        first = false;
+
+        int nbSpans = buffer->_spans.size();
+        for (int i = 0 ; i < nbSpans ; ++i)
+        {
+            const TraceBuffer::Span &span = buffer->_spans.at((buffer->_next + i) % nbSpans); // oldest first
+            stream << QString(",\n{\"name\":\"%1\",\"cat\":\"nzbCheck\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,\"ts\":%3,\"dur\":%4}").arg(
+                          span.name).arg(
+                          buffer->_tid).arg(
+                          span.start / 1000.,    0, 'f', 3).arg(
+                          span.duration / 1000., 0, 'f', 3);
+        }
+    }
+    stream << "\n]}\n";
+    stream.flush();
+
+    if (file.error() != QFileDevice::NoError)
+    {
+        error = QString("Error writing trace file %1: %2").arg(_filePath).arg(file.errorString());
+        return false;
+    }
+    return true;
+}
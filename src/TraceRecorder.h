@@ -0,0 +1,105 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QElapsedTimer>
+
+/*!
+ * \brief spans of one track (a connection or the main thread)
+ * it has a single writer so no locking is needed, the spans are preallocated
+ * and their names must be static strings (no allocation on the hot path)
+ * it's a ring buffer: beyond its capacity the newest span overwrites the oldest one
+ * (a long watch or pool run keeps its last spans in bounded memory)
+ */
+class TraceBuffer
+{
+public:
+    struct Span {
+        const char *name;
+        qint64      start;    //!< ns since the start of the run
+        qint64      duration; //!< ns
+    };
+
+    TraceBuffer(const QElapsedTimer &clock, int tid, const QString &name, int capacity);
+
+    inline qint64 now() const;
+    inline void addSpan(const char *name, qint64 start);
+
+private:
+    const QElapsedTimer &_clock;
+    const int            _tid;
+    const QString        _name;
+    const int            _capacity;
+    QVector<Span>        _spans;
+    int                  _next;      //!< next span to overwrite once _spans is full (the oldest one)
+    qint64               _nbDropped; //!< spans overwritten
+
+    friend class TraceRecorder;
+};
+
+/*!
+ * \brief collects the TraceBuffers of a run and write them
+ * in Chrome trace-event format (to be opened in Perfetto or chrome://tracing)
+ * newBuffer() must be called from the main thread
+ */
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(const QString &filePath);
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &other) = delete;
+    TraceRecorder & operator=(const TraceRecorder &other) = delete;
+
+    TraceBuffer *newBuffer(const QString &name, int capacity);
+
+    bool write(QString &error) const;
+
+    inline const QString &filePath() const;
+
+private:
+    const QString       _filePath;
+    QElapsedTimer       _clock;
+    QList<TraceBuffer*> _buffers;
+};
+
+qint64 TraceBuffer::now() const { return _clock.nsecsElapsed(); }
+
+void TraceBuffer::addSpan(const char *name, qint64 start)
+{
+    if (_spans.size() < _capacity)
+        _spans.append({name, start, _clock.nsecsElapsed() - start});
+    else
+    {
+        _spans[_next] = {name, start, _clock.nsecsElapsed() - start};
+        _next = (_next + 1) % _capacity;
+        ++_nbDropped;
+    }
+}
+
+const QString &TraceRecorder::filePath() const { return _filePath; }
+
+#endif // TRACERECORDER_H
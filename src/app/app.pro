@@ -0,0 +1,46 @@
+# nzbcheck command line, a thin main over libnzbcheck
+QT -= gui
+QT += network concurrent
+
+TARGET = nzbcheck
+DESTDIR = $$OUT_PWD/..
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+win32: {
+    RC_ICONS += ../nzbCheck.ico
+}
+
+macx: {
+    ICON = ../nzbCheck.icns
+    CONFIG += app_bundle
+}
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        ../MemoryHook.cpp \
+        ../main.cpp
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../lib/release/ -lnzbcheck
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../lib/debug/ -lnzbcheck
+else:unix: LIBS += -L$$OUT_PWD/../lib/ -lnzbcheck
+
+# zlib for COMPRESS DEFLATE (NntpCompression)
+unix: LIBS += -lz
+win32: LIBS += -lzlib
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/libnzbcheck.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/libnzbcheck.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/nzbcheck.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/nzbcheck.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../lib/libnzbcheck.a
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,58 @@
+# libnzbcheck: the checking engine (parser, connections, scheduler)
+# to be embedded in other Qt applications (cf NzbCheck library API)
+TEMPLATE = lib
+TARGET = nzbcheck
+
+QT -= gui
+QT += network concurrent
+
+CONFIG += c++11 staticlib
+
+INCLUDEPATH += ..
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        ../BrokerClient.cpp \
+        ../Checkpoint.cpp \
+        ../ConnectionBroker.cpp \
+        ../ConnectionLedger.cpp \
+        ../MemoryStats.cpp \
+        ../Nntp.cpp \
+        ../NntpCompression.cpp \
+        ../NntpCon.cpp \
+        ../NntpScheduler.cpp \
+        ../NzbAnalysis.cpp \
+        ../NzbCheck.cpp \
+        ../NzbParser.cpp \
+        ../NzbWatcher.cpp \
+        ../ResultFile.cpp \
+        ../SessionRecorder.cpp \
+        ../SessionReplay.cpp \
+        ../ShardCoordinator.cpp \
+        ../ShardWorker.cpp \
+        ../TraceRecorder.cpp
+
+HEADERS += \
+    ../BrokerClient.h \
+    ../Checkpoint.h \
+    ../ConnectionBroker.h \
+    ../ConnectionLedger.h \
+    ../MemoryStats.h \
+    ../Nntp.h \
+    ../NntpCompression.h \
+    ../NntpCon.h \
+    ../NntpScheduler.h \
+    ../NntpServerParams.h \
+    ../NzbAnalysis.h \
+    ../NzbCheck.h \
+    ../NzbJob.h \
+    ../NzbParser.h \
+    ../NzbWatcher.h \
+    ../PureStaticClass.h \
+    ../ResultFile.h \
+    ../SessionRecorder.h \
+    ../SessionReplay.h \
+    ../ShardCoordinator.h \
+    ../ShardWorker.h \
+    ../TraceRecorder.h
@@ -1,5 +1,8 @@
 #include "NzbCheck.h"
 #include <QCoreApplication>
+#include <algorithm>
+
+static const int sMaxExitCode = 250; //!< the negative codes are read as 255, 254...
 
 int main(int argc, char *argv[])
 {
@@ -7,12 +10,33 @@ int main(int argc, char *argv[])
     NzbCheck nzbCheck;
     if (nzbCheck.parseCommandLine(argc, argv))
     {
+        if (nzbCheck.offlineMode())
+            return std::min(nzbCheck.analyseOffline(), sMaxExitCode);
+
+        if (nzbCheck.watchMode())
+            return nzbCheck.startWatching() ? a.exec() : -1;
+
+        if (nzbCheck.workerMode())
+            return nzbCheck.startWorker() ? a.exec() : -1;
+
+        if (nzbCheck.brokerMode())
+            return nzbCheck.startBroker() ? a.exec() : -1;
+
+        if (nzbCheck.matrixMode())
+        {
+            if (!nzbCheck.checkMatrix())
+                return -1;
+            a.exec();
+            return std::min(nzbCheck.nbMissingArticles(), sMaxExitCode);
+        }
+
         int nbArticles = nzbCheck.parseNzb();
         if (nbArticles > 0 )
         {
-            nzbCheck.checkPost();
-            a.exec(); // start event loop
-            return nzbCheck.nbMissingArticles();
+            if (nzbCheck.coordinatorMode() ? nzbCheck.startCoordinator() : nzbCheck.checkPost())
+                a.exec(); // start event loop
+            // exit codes are truncated to 8 bits: saturate (use --result or libnzbcheck for the exact count)
+            return std::min(nzbCheck.nbMissingArticles(), sMaxExitCode);
         }
         else
             return nbArticles;
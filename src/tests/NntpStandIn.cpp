@@ -0,0 +1,186 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NntpStandIn.h"
+
+NntpStandIn::Session::Session()
+    : compressed(false), inflater(), deflater(), commands(), chunks()
+{
+    // raw DEFLATE streams (no zlib header)
+    inflateInit2(&inflater, -MAX_WBITS);
+    deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+}
+
+NntpStandIn::Session::~Session()
+{
+    inflateEnd(&inflater);
+    deflateEnd(&deflater);
+}
+
+NntpStandIn::NntpStandIn(const QSet<QString> &missing, bool acceptCompress, bool splitReplies)
+    : QObject(), _server(), _sessions(), _missing(missing), _acceptCompress(acceptCompress),
+      _splitReplies(splitReplies), _nbCompressedCommands(0), _writeTimer()
+{
+    connect(&_server,     &QTcpServer::newConnection, this, &NntpStandIn::onNewConnection);
+    connect(&_writeTimer, &QTimer::timeout,           this, &NntpStandIn::onWriteTimer);
+    _server.listen(QHostAddress::LocalHost);
+}
+
+NntpStandIn::~NntpStandIn()
+{
+    qDeleteAll(_sessions);
+}
+
+void NntpStandIn::onNewConnection()
+{
+    while (_server.hasPendingConnections())
+    {
+        QTcpSocket *client  = _server.nextPendingConnection();
+        Session    *session = new Session();
+        _sessions.insert(client, session);
+        connect(client, &QIODevice::readyRead,             this, &NntpStandIn::onReadyRead);
+        connect(client, &QAbstractSocket::disconnected,    this, &NntpStandIn::onDisconnected);
+        _reply(client, session, "200 nntp stand-in ready\r\n");
+    }
+}
+
+void NntpStandIn::onReadyRead()
+{
+    QTcpSocket *client  = static_cast<QTcpSocket*>(sender());
+    Session    *session = _sessions.value(client);
+    if (!session)
+        return;
+
+    QByteArray in = client->readAll();
+    session->commands += session->compressed ? _zlib(session->inflater, in, false) : in;
+    int end;
+    while ((end = session->commands.indexOf("\r\n")) >= 0)
+    {
+        QByteArray cmd = session->commands.left(end);
+        session->commands.remove(0, end + 2);
+        _command(client, session, cmd);
+    }
+}
+
+void NntpStandIn::onDisconnected()
+{
+    QTcpSocket *client = static_cast<QTcpSocket*>(sender());
+    delete _sessions.take(client);
+    client->deleteLater();
+}
+
+void NntpStandIn::onWriteTimer()
+{
+    bool pending = false;
+    for (auto it = _sessions.cbegin(), itEnd = _sessions.cend(); it != itEnd; ++it)
+    {
+        Session *session = it.value();
+        if (!session->chunks.isEmpty())
+        {
+            it.key()->write(session->chunks.dequeue());
+            it.key()->flush();
+            pending = pending || !session->chunks.isEmpty();
+        }
+    }
+    if (!pending)
+        _writeTimer.stop();
+}
+
+void NntpStandIn::_command(QTcpSocket *client, Session *session, const QByteArray &cmd)
+{
+    if (session->compressed)
+        ++_nbCompressedCommands;
+
+    QList<QByteArray> words = cmd.split(' ');
+    QByteArray verb = words.first().toUpper();
+    if (verb == "COMPRESS")
+    {
+        if (_acceptCompress)
+        {
+            _reply(client, session, "206 Compression active\r\n");
+            session->compressed = true; // from the next byte in both directions
+        }
+        else
+            _reply(client, session, "502 COMPRESS not available\r\n");
+    }
+    else if ((verb == "STAT" || verb == "HEAD") && words.size() == 2)
+    {
+        const QByteArray &msgId = words.at(1);
+        if (_missing.contains(QString(msgId)))
+            _reply(client, session, "430 No such article\r\n");
+        else if (verb == "STAT")
+            _reply(client, session, "223 0 " + msgId + "\r\n");
+        else
+        {
+            // the part is the local part of the message-id: <part@standin>
+            // folded headers: only the Subject continuation belongs to the Subject
+            QByteArray part = msgId.mid(1, msgId.indexOf('@') - 1);
+            _reply(client, session, "221 0 " + msgId + "\r\n"
+                   "Subject: test.bin\r\n"
+                   " yEnc (" + part + "/3)\r\n"
+                   "X-Folded: other\r\n"
+                   "\t(9/9)\r\n"
+                   "Bytes: 1000\r\n"
+                   "Lines: 8\r\n"
+                   ".\r\n");
+        }
+    }
+    else if (verb == "QUIT")
+        _reply(client, session, "205 Bye\r\n");
+    else
+        _reply(client, session, "500 Unknown command\r\n");
+}
+
+void NntpStandIn::_reply(QTcpSocket *client, Session *session, const QByteArray &reply)
+{
+    QByteArray out = session->compressed ? _zlib(session->deflater, reply, true) : reply;
+    if (!_splitReplies)
+    {
+        client->write(out);
+        return;
+    }
+
+    // cut mid-line (and mid-block when deflated)
+    int third = std::max(1, out.size() / 3);
+    for (int pos = 0; pos < out.size(); pos += third)
+        session->chunks.enqueue(out.mid(pos, third));
+    if (!_writeTimer.isActive())
+        _writeTimer.start(sWriteInterval);
+}
+
+QByteArray NntpStandIn::_zlib(z_stream &stream, const QByteArray &in, bool deflating)
+{
+    QByteArray out;
+    char buffer[4096];
+    stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(in.constData()));
+    stream.avail_in = static_cast<uInt>(in.size());
+    do
+    {
+        stream.next_out  = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        if (deflating)
+            deflate(&stream, Z_SYNC_FLUSH);
+        else
+            inflate(&stream, Z_SYNC_FLUSH);
+        out.append(buffer, static_cast<int>(sizeof(buffer) - stream.avail_out));
+    } while (stream.avail_out == 0);
+    return out;
+}
@@ -0,0 +1,87 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#ifndef NNTPSTANDIN_H
+#define NNTPSTANDIN_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QQueue>
+#include <QHash>
+#include <QSet>
+#include <zlib.h>
+
+/*!
+ * \brief NNTP server on localhost answering STAT and HEAD, with or without COMPRESS DEFLATE (RFC 8054)
+ * it serves several clients at once (the connections of NzbCheck, of the shard workers...)
+ * with splitReplies, each reply is written in three pieces a few ms apart
+ * so the client reads it across several readyRead
+ */
+class NntpStandIn : public QObject
+{
+    Q_OBJECT
+
+public:
+    NntpStandIn(const QSet<QString> &missing, bool acceptCompress = false, bool splitReplies = false);
+    ~NntpStandIn();
+
+    inline ushort port() const;
+    inline int nbCompressedCommands() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onWriteTimer();
+
+private:
+    struct Session
+    {
+        bool               compressed;  //!< 206 sent: both directions are deflated
+        z_stream           inflater;
+        z_stream           deflater;
+        QByteArray         commands;    //!< received (inflated), not complete yet
+        QQueue<QByteArray> chunks;      //!< pieces of the replies still to write
+
+        Session();
+        ~Session();
+    };
+
+    QTcpServer                    _server;
+    QHash<QTcpSocket*, Session*>  _sessions;
+    const QSet<QString>           _missing;
+    const bool                    _acceptCompress;
+    const bool                    _splitReplies;
+    int                           _nbCompressedCommands;
+    QTimer                        _writeTimer;
+
+    static const int sWriteInterval = 5; //!< ms between two pieces
+
+    void _command(QTcpSocket *client, Session *session, const QByteArray &cmd);
+    void _reply(QTcpSocket *client, Session *session, const QByteArray &reply);
+    static QByteArray _zlib(z_stream &stream, const QByteArray &in, bool deflating);
+};
+
+ushort NntpStandIn::port() const { return _server.serverPort(); }
+int NntpStandIn::nbCompressedCommands() const { return _nbCompressedCommands; }
+
+#endif // NNTPSTANDIN_H
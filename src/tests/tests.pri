@@ -0,0 +1,29 @@
+# included by each test: links libnzbcheck like the command line (cf app/app.pro)
+QT -= gui
+QT += network concurrent testlib
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../lib/release/ -lnzbcheck
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../lib/debug/ -lnzbcheck
+else:unix: LIBS += -L$$OUT_PWD/../../lib/ -lnzbcheck
+
+# zlib for COMPRESS DEFLATE (NntpCompression)
+unix: LIBS += -lz
+win32: LIBS += -lzlib
+
+INCLUDEPATH += $$PWD/.. $$PWD
+DEPENDPATH += $$PWD/.. $$PWD
+
+# shared stand-ins
+HEADERS += $$PWD/NntpStandIn.h
+SOURCES += $$PWD/NntpStandIn.cpp
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../lib/release/libnzbcheck.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../lib/debug/libnzbcheck.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../lib/release/nzbcheck.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../lib/debug/nzbcheck.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../../lib/libnzbcheck.a
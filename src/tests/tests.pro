@@ -0,0 +1,8 @@
+# QtTest, run with make check: each test starts its stand-ins on localhost
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_compression \
+    tst_resultfile \
+    tst_retention \
+    tst_shard
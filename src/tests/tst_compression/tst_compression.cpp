@@ -0,0 +1,91 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbCheck.h"
+#include "NntpServerParams.h"
+#include "NntpStandIn.h"
+#include <QtTest>
+
+
+class TestCompression : public QObject
+{
+    Q_OBJECT
+
+private:
+    static const int sTimeout = 5000; //!< ms for a job of 3 Articles on localhost
+
+private slots:
+    void check_data();
+    void check();
+};
+
+void TestCompression::check_data()
+{
+    QTest::addColumn<bool>("acceptCompress");
+    QTest::addColumn<bool>("headMode");
+
+    QTest::newRow("STAT deflated")          << true  << false;
+    QTest::newRow("HEAD deflated")          << true  << true;
+    QTest::newRow("STAT, COMPRESS refused") << false << false;
+    QTest::newRow("HEAD, COMPRESS refused") << false << true;
+}
+
+void TestCompression::check()
+{
+    QFETCH(bool, acceptCompress);
+    QFETCH(bool, headMode);
+
+    NntpStandIn standIn({"<2@standin>"}, acceptCompress, true);
+    QVERIFY(standIn.port() != 0);
+
+    NzbFile nzbFile{"test.bin yEnc (1/3)", 0, 3, {}};
+    for (int part = 1; part <= 3; ++part)
+        nzbFile.segments << NzbSegment{QString("<%1@standin>").arg(part), 1000, part};
+
+    NzbCheck checker;
+    checker.setQuietMode(true);
+    checker.setHeadMode(headMode);
+    checker.setCompressMode(true);
+    checker.addServer(NntpServerParams("127.0.0.1", standIn.port()));
+
+    QSignalSpy results(&checker,    &NzbCheck::articleResult);
+    QSignalSpy mismatches(&checker, &NzbCheck::articleMismatch);
+    QSignalSpy finished(&checker,   &NzbCheck::jobFinished);
+    QVERIFY(checker.startPool());
+    int jobId = checker.checkSegments("stand-in", {nzbFile});
+
+    QVERIFY(finished.wait(sTimeout));
+    QCOMPARE(finished.first().at(0).toInt(), jobId);
+    QCOMPARE(finished.first().at(1).toInt(), 3);
+    QCOMPARE(finished.first().at(2).toInt(), 1);
+    QCOMPARE(results.size(), 3);
+    for (const QList<QVariant> &result : results)
+        QCOMPARE(result.at(2).toBool(), result.at(1).toString() == "<2@standin>");
+    QCOMPARE(mismatches.size(), 0); // the headers of the multi-line replies were read whole (and unfolded)
+
+    if (acceptCompress)
+        QVERIFY(standIn.nbCompressedCommands() >= 3);
+    else
+        QCOMPARE(standIn.nbCompressedCommands(), 0); // plain text after the refusal
+}
+
+QTEST_GUILESS_MAIN(TestCompression)
+#include "tst_compression.moc"
@@ -0,0 +1,7 @@
+# COMPRESS DEFLATE against an NNTP stand-in (QTcpServer on localhost)
+TARGET = tst_compression
+
+include(../tests.pri)
+
+SOURCES += \
+        tst_compression.cpp
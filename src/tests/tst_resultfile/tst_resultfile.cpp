@@ -0,0 +1,197 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "ResultFile.h"
+#include <QtTest>
+#include <QTemporaryDir>
+
+bool operator==(const ResultFile::Range &a, const ResultFile::Range &b)
+{
+    return a.first == b.first && a.count == b.count;
+}
+
+class TestResultFile : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir _dir;
+
+    //! three files: nothing missing, missing and unchecked ranges, a last range at the very end of the file
+    static QVector<ResultFile::FileResult> _files();
+    static QString _write(const QString &filePath);
+    static bool _readAll(const QString &filePath, QVector<ResultFile::FileResult> &files);
+    static qint64 _indexPos();
+
+private slots:
+    void ranges();
+    void roundTrip();
+    void truncated();
+    void corruptedIndex();
+    void notAResult();
+};
+
+QVector<ResultFile::FileResult> TestResultFile::_files()
+{
+    return {
+        {"complete.bin yEnc (1/10)", 10, 10, {}, {}},
+        {"holes.bin yEnc (1/20)",    20, 20, {{1, 2}, {5, 1}}, {{8, 3}, {20, 1}}},
+        {"dead.bin",                 15, 0,  {}, {{11, 5}}}, // ends with a range
+    };
+}
+
+QString TestResultFile::_write(const QString &filePath)
+{
+    QString error;
+    if (!ResultFile::write(filePath, "test.nzb", 45, 3, 37, _files(), error))
+        return error;
+    return QString();
+}
+
+bool TestResultFile::_readAll(const QString &filePath, QVector<ResultFile::FileResult> &files)
+{
+    ResultFile result(filePath);
+    QString    error;
+    if (!result.open(error))
+        return false;
+    files.resize(result.nbFiles());
+    for (int i = 0; i < result.nbFiles(); ++i)
+    {
+        if (!result.file(i, files[i]))
+            return false;
+    }
+    return true;
+}
+
+qint64 TestResultFile::_indexPos()
+{
+    // magic, version, "test.nzb" (length + UTF-16), nbArticles, nbMissing, nbChecked, nbFiles
+    return 4 + 2 + 4 + 2 * 8 + 4 * 4;
+}
+
+void TestResultFile::ranges()
+{
+    NzbFile nzbFile{"test.bin yEnc (1/10)", 0, 10, {}};
+    for (int number : {1, 2, 3, 4, 6, 7, 8}) // 5, 9 and 10 are not in the nzb
+        nzbFile.segments << NzbSegment{QString("<%1@test>").arg(number), 1000, number};
+
+    QVector<ResultFile::Range> missing = ResultFile::missingRanges(nzbFile, {"<2@test>", "<3@test>", "<8@test>"});
+    QCOMPARE(missing, (QVector<ResultFile::Range>{{2, 2}, {5, 1}, {8, 3}}));
+
+    QVector<ResultFile::Range> unchecked = ResultFile::uncheckedRanges(nzbFile, {"<1@test>", "<2@test>", "<3@test>", "<7@test>"});
+    QCOMPARE(unchecked, (QVector<ResultFile::Range>{{4, 1}, {6, 1}, {8, 1}})); // not the ones absent from the nzb
+}
+
+void TestResultFile::roundTrip()
+{
+    QString filePath = _dir.filePath("roundTrip.nzbr");
+    QCOMPARE(_write(filePath), QString());
+    QVERIFY(ResultFile::isResultFile(filePath));
+
+    ResultFile result(filePath);
+    QString    error;
+    QVERIFY2(result.open(error), qPrintable(error));
+    QCOMPARE(result.nzbName(), QString("test.nzb"));
+    QCOMPARE(result.nbArticles(), 45);
+    QCOMPARE(result.nbMissing(), 3);
+    QCOMPARE(result.nbChecked(), 37);
+    QCOMPARE(result.nbFiles(), 3);
+
+    // in any order: each record is read on its own
+    const QVector<ResultFile::FileResult> files = _files();
+    for (int i : {2, 0, 1})
+    {
+        ResultFile::FileResult fileResult;
+        QVERIFY(result.file(i, fileResult));
+        QCOMPARE(fileResult.subject,            files.at(i).subject);
+        QCOMPARE(fileResult.nbSegments,         files.at(i).nbSegments);
+        QCOMPARE(fileResult.nbExpectedSegments, files.at(i).nbExpectedSegments);
+        QCOMPARE(fileResult.missing,            files.at(i).missing);
+        QCOMPARE(fileResult.unchecked,          files.at(i).unchecked);
+    }
+    ResultFile::FileResult fileResult;
+    QVERIFY(!result.file(3, fileResult));
+    QVERIFY(!result.file(-1, fileResult));
+}
+
+void TestResultFile::truncated()
+{
+    QString filePath = _dir.filePath("full.nzbr");
+    QCOMPARE(_write(filePath), QString());
+    QFile full(filePath);
+    QVERIFY(full.open(QIODevice::ReadOnly));
+    QByteArray bytes = full.readAll();
+
+    // the last byte belongs to the last range: any truncation loses something
+    QString truncatedPath = _dir.filePath("truncated.nzbr");
+    for (int size = 0; size < bytes.size(); ++size)
+    {
+        QFile truncated(truncatedPath);
+        QVERIFY(truncated.open(QIODevice::WriteOnly|QIODevice::Truncate));
+        truncated.write(bytes.left(size));
+        truncated.close();
+
+        QVector<ResultFile::FileResult> files;
+        QVERIFY2(!_readAll(truncatedPath, files), qPrintable(QString("truncated at %1 bytes").arg(size)));
+    }
+}
+
+void TestResultFile::corruptedIndex()
+{
+    QString filePath = _dir.filePath("corrupted.nzbr");
+    for (int field = 0; field < 3; ++field)
+    {
+        QCOMPARE(_write(filePath), QString());
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        // entry of the second file: offset (8), nbMissingRanges (4), nbUncheckedRanges (4)
+        QVERIFY(file.seek(_indexPos() + 16 + (field == 0 ? 0 : field == 1 ? 8 : 12)));
+        if (field == 0)
+            stream << static_cast<quint64>(1);          // in the header
+        else
+            stream << static_cast<quint32>(0x10000000); // far more ranges than the file holds
+        file.close();
+
+        ResultFile result(filePath);
+        QString    error;
+        QVERIFY(!result.open(error));
+        QVERIFY(!error.isEmpty());
+    }
+}
+
+void TestResultFile::notAResult()
+{
+    QString filePath = _dir.filePath("previous.json");
+    QFile json(filePath);
+    QVERIFY(json.open(QIODevice::WriteOnly));
+    json.write("{\"nzb\": \"test.nzb\", \"missing\": []}");
+    json.close();
+    QVERIFY(!ResultFile::isResultFile(filePath)); // what --previous checks to refuse a .nzbr
+
+    ResultFile result(filePath);
+    QString    error;
+    QVERIFY(!result.open(error));
+}
+
+QTEST_GUILESS_MAIN(TestResultFile)
+#include "tst_resultfile.moc"
@@ -0,0 +1,7 @@
+# --result-format bin: ResultFile written then read back, truncated and corrupted files refused
+TARGET = tst_resultfile
+
+include(../tests.pri)
+
+SOURCES += \
+        tst_resultfile.cpp
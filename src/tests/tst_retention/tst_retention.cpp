@@ -0,0 +1,135 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbCheck.h"
+#include "NntpStandIn.h"
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDateTime>
+
+/*!
+ * \brief a long retention server that is slow and a short retention one that is fast
+ * the short one doesn't have the old post anymore (430): its idle connections must not steal
+ * nor hedge the Articles of the old post, nothing is missing
+ */
+class TestRetention : public QObject
+{
+    Q_OBJECT
+
+private:
+    static const int sNbOld    = 300; //!< Articles of the post of 100 days
+    static const int sNbRecent = 100;
+    static const int sOldDays  = 100;
+    static const int sTimeout  = 30000; //!< ms
+
+    static bool _writeNzb(const QString &path);
+    static bool _parse(NzbCheck &nzbCheck, const QStringList &args);
+
+private slots:
+    void agedStayOnLongRetention_data();
+    void agedStayOnLongRetention();
+};
+
+bool TestRetention::_writeNzb(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Text))
+        return false;
+
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    QTextStream stream(&file);
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           << "<nzb xmlns=\"http://www.newzbin.com/DTD/2003/nzb\">\n";
+    struct Post {
+        QString name;
+        qint64  date;
+        int     nbArticles;
+    };
+    const QList<Post> posts = {{"old", now - sOldDays * 86400, sNbOld}, {"recent", now, sNbRecent}};
+    for (const Post &post : posts)
+    {
+        stream << " <file poster=\"tester\" date=\"" << post.date << "\" subject=\"" << post.name
+               << ".bin yEnc (1/" << post.nbArticles << ")\">\n"
+               << "  <groups><group>alt.binaries.test</group></groups>\n"
+               << "  <segments>\n";
+        for (int part = 1; part <= post.nbArticles; ++part)
+            stream << "   <segment bytes=\"1000\" number=\"" << part << "\">" << post.name << part << "@standin</segment>\n";
+        stream << "  </segments>\n"
+               << " </file>\n";
+    }
+    stream << "</nzb>\n";
+    return true;
+}
+
+bool TestRetention::_parse(NzbCheck &nzbCheck, const QStringList &args)
+{
+    QList<QByteArray> storage;
+    QVector<char*>    argv;
+    storage << "nzbcheck";
+    for (const QString &arg : args)
+        storage << arg.toLocal8Bit();
+    for (QByteArray &arg : storage)
+        argv << arg.data();
+    return nzbCheck.parseCommandLine(argv.size(), argv.data());
+}
+
+void TestRetention::agedStayOnLongRetention_data()
+{
+    QTest::addColumn<QStringList>("options");
+
+    QTest::newRow("steal") << QStringList{"--pipeline", "4"};
+    QTest::newRow("hedge") << QStringList{"--pipeline", "4", "--hedge", "50"};
+}
+
+void TestRetention::agedStayOnLongRetention()
+{
+    QFETCH(QStringList, options);
+
+    // the short retention server has expired the old post
+    QSet<QString> expired;
+    for (int part = 1; part <= sNbOld; ++part)
+        expired << QString("<old%1@standin>").arg(part);
+    NntpStandIn longRetention({}, false, true); // replies cut in 3 pieces 5 ms apart: the slow one
+    NntpStandIn shortRetention(expired);
+    QVERIFY(longRetention.port() != 0 && shortRetention.port() != 0);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString nzbPath = dir.filePath("retention.nzb");
+    QVERIFY(_writeNzb(nzbPath));
+
+    NzbCheck checker;
+    QVERIFY(_parse(checker, QStringList{"-q", "-i", nzbPath,
+                                        "-S", QString("127.0.0.1:%1:2:nossl:3000d").arg(longRetention.port()),
+                                        "-S", QString("127.0.0.1:%1:2:nossl:10d").arg(shortRetention.port())} + options));
+    QCOMPARE(checker.parseNzb(), sNbOld + sNbRecent);
+
+    QElapsedTimer timer;
+    timer.start();
+    QTimer::singleShot(sTimeout, qApp, &QCoreApplication::quit);
+    QVERIFY(checker.checkPost());
+    qApp->exec();
+    QVERIFY2(timer.elapsed() < sTimeout, "the check didn't finish");
+    QCOMPARE(checker.nbMissingArticles(), 0); // a 430 of the short retention server would count as missing
+}
+
+QTEST_GUILESS_MAIN(TestRetention)
+#include "tst_retention.moc"
@@ -0,0 +1,7 @@
+# aged Articles kept on the servers whose retention covers them (steal, hedge) with two stand-ins
+TARGET = tst_retention
+
+include(../tests.pri)
+
+SOURCES += \
+        tst_retention.cpp
@@ -0,0 +1,133 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+#include "NzbCheck.h"
+#include "NntpStandIn.h"
+#include <QtTest>
+#include <QTemporaryDir>
+
+/*!
+ * \brief a coordinator and its workers on localhost, all in the same event loop
+ * two fake workers take ranges: one is killed (abort), one never answers (dropped after the worker timeout)
+ * the two real workers must end up checking all the Articles
+ */
+class TestShard : public QObject
+{
+    Q_OBJECT
+
+private:
+    static const int sNbArticles = 3000;  //!< 6 ranges: 2 for each fake worker, 2 for the real ones
+    static const int sMissingStep = 100;  //!< every 100th Article is missing on the stand-in
+    static const int sTimeout = 60000;    //!< ms, the hung worker is only dropped after ShardCoordinator::sWorkerTimeout
+
+    static ushort _freePort();
+    static bool _writeNzb(const QString &path);
+    static bool _parse(NzbCheck &nzbCheck, const QStringList &args);
+
+private slots:
+    void lostWorkers();
+};
+
+ushort TestShard::_freePort()
+{
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost);
+    return server.serverPort(); // released when server is destroyed
+}
+
+bool TestShard::_writeNzb(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Text))
+        return false;
+
+    QTextStream stream(&file);
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           << "<nzb xmlns=\"http://www.newzbin.com/DTD/2003/nzb\">\n"
+           << " <file poster=\"tester\" subject=\"test.bin yEnc (1/" << sNbArticles << ")\">\n"
+           << "  <groups><group>alt.binaries.test</group></groups>\n"
+           << "  <segments>\n";
+    for (int part = 1; part <= sNbArticles; ++part)
+        stream << "   <segment bytes=\"1000\" number=\"" << part << "\">" << part << "@standin</segment>\n";
+    stream << "  </segments>\n"
+           << " </file>\n"
+           << "</nzb>\n";
+    return true;
+}
+
+bool TestShard::_parse(NzbCheck &nzbCheck, const QStringList &args)
+{
+    QList<QByteArray> storage;
+    QVector<char*>    argv;
+    storage << "nzbcheck";
+    for (const QString &arg : args)
+        storage << arg.toLocal8Bit();
+    for (QByteArray &arg : storage)
+        argv << arg.data();
+    return nzbCheck.parseCommandLine(argv.size(), argv.data());
+}
+
+void TestShard::lostWorkers()
+{
+    QSet<QString> missing;
+    for (int part = sMissingStep; part <= sNbArticles; part += sMissingStep)
+        missing << QString("<%1@standin>").arg(part);
+    NntpStandIn standIn(missing);
+    QVERIFY(standIn.port() != 0);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString nzbPath = dir.filePath("shard.nzb");
+    QVERIFY(_writeNzb(nzbPath));
+
+    ushort port = _freePort();
+    QVERIFY(port != 0);
+    NzbCheck coordinator;
+    QVERIFY(_parse(coordinator, {"-q", "--coordinator", QString::number(port), "-i", nzbPath}));
+    QCOMPARE(coordinator.parseNzb(), int(sNbArticles));
+    QVERIFY(coordinator.startCoordinator());
+
+    // the fake workers take their ranges first
+    QTcpSocket killed, hung;
+    killed.connectToHost(QHostAddress::LocalHost, port);
+    hung.connectToHost(QHostAddress::LocalHost, port);
+    QTRY_VERIFY_WITH_TIMEOUT(killed.canReadLine() && hung.canReadLine(), 5000);
+    killed.abort(); // like a killed process: the coordinator sees the disconnection
+
+    QString server = QString("127.0.0.1:%1:2:nossl").arg(standIn.port());
+    QString coordinatorAddress = QString("127.0.0.1:%1").arg(port);
+    NzbCheck worker1, worker2;
+    QVERIFY(_parse(worker1, {"-q", "--worker", coordinatorAddress, "-S", server}));
+    QVERIFY(_parse(worker2, {"-q", "--worker", coordinatorAddress, "-S", server}));
+    QVERIFY(worker1.startWorker());
+    QVERIFY(worker2.startWorker());
+
+    // the coordinator quits the event loop once every Article is checked
+    QElapsedTimer timer;
+    timer.start();
+    QTimer::singleShot(sTimeout, qApp, &QCoreApplication::quit);
+    qApp->exec();
+    QVERIFY2(timer.elapsed() < sTimeout, "the coordinator didn't finish: ranges were not given back");
+    QCOMPARE(coordinator.nbMissingArticles(), missing.size());
+}
+
+QTEST_GUILESS_MAIN(TestShard)
+#include "tst_shard.moc"
@@ -0,0 +1,7 @@
+# --coordinator handing ranges to --worker processes (in-process here), one killed, one hung
+TARGET = tst_shard
+
+include(../tests.pri)
+
+SOURCES += \
+        tst_shard.cpp
@@ -0,0 +1,208 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+// nzbBench: measure the nzb parsing speed and memory
+// each input is parsed in a child process so its peak memory is not polluted by the others
+#include "NzbParser.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QStack>
+#include <QProcess>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <algorithm>
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+    #define MB_FLUSH flush
+#else
+    #define MB_FLUSH Qt::flush
+#endif
+
+namespace
+{
+//! peak resident memory of the current process in KB (-1 if not available)
+qint64 peakRssKB()
+{
+#if defined(Q_OS_MACOS)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024; // bytes on MacOS
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
+
+//! same work than NzbCheck::parseNzb: parse and stack the Articles
+//! single threaded parse if maxThreads < 0, NzbParser::parseParallel otherwise (nbChunks is set)
+int parseOnce(const QString &nzbPath, qint64 &nsecs, QString &error, int maxThreads, int &nbChunks)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(nzbPath);
+    if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        error = file.errorString();
+        return -1;
+    }
+    QVector<NzbFile> nzbFiles;
+    nbChunks = maxThreads < 0 ? (NzbParser::parse(&file, nzbFiles, error) ? 1 : -1)
+                              : NzbParser::parseParallel(file, nzbFiles, error, maxThreads);
+    if (nbChunks < 0)
+        return -2;
+
+    QStack<QString> articles;
+    for (const NzbFile &nzbFile : nzbFiles)
+        for (const NzbSegment &segment : nzbFile.segments)
+            articles.push(segment.msgId);
+    nsecs = timer.nsecsElapsed();
+    return articles.size();
+}
+
+//! child process: print "<nbSegments> <best nsecs> <peak RSS KB>" or "error <msg>"
+//! followed by " <best parallel nsecs> <nbChunks>" if maxThreads >= 0
+int runChild(const QString &nzbPath, int nbRuns, int maxThreads)
+{
+    QTextStream out(stdout);
+    qint64 best = -1, bestParallel = -1;
+    int nbSegments = 0, nbChunks = 1;
+    QList<int> modes = {-1}; // single threaded
+    if (maxThreads >= 0)
+        modes << maxThreads;
+    for (int i = 0; i < nbRuns; ++i)
+    {
+        for (int threads : modes)
+        {
+            qint64  nsecs = 0;
+            QString error;
+            nbSegments = parseOnce(nzbPath, nsecs, error, threads, nbChunks);
+            if (nbSegments < 0)
+            {
+                out << "error " << error << "\n";
+                return 1;
+            }
+            qint64 &bestTime = threads < 0 ? best : bestParallel;
+            if (bestTime < 0 || nsecs < bestTime)
+                bestTime = nsecs;
+        }
+    }
+    out << nbSegments << " " << best << " " << peakRssKB();
+    if (maxThreads >= 0)
+        out << " " << bestParallel << " " << nbChunks;
+    out << "\n";
+    return 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("benchmark the nzbCheck parser (throughput and peak memory)");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"r", "runs"}, "number of parsing per input, the best one is kept (default 3)", "runs", "3"},
+        {{"t", "threads"}, "also parse with NzbParser::parseParallel on that many threads (0 for the number of cores) and report the speed-up", "threads"},
+        {"child",       "internal: parse a single nzb and print the raw measures", "child"}
+    });
+    parser.addPositionalArgument("inputs", "nzb files or folders of nzbs", "inputs...");
+    parser.process(app);
+
+    int nbRuns     = std::max(1, parser.value("runs").toInt());
+    int maxThreads = parser.isSet("threads") ? std::max(0, parser.value("threads").toInt()) : -1;
+    if (parser.isSet("child"))
+        return runChild(parser.value("child"), nbRuns, maxThreads);
+
+    QStringList nzbPaths;
+    for (const QString &input : parser.positionalArguments())
+    {
+        QFileInfo fi(input);
+        if (fi.isDir())
+        {
+            for (const QFileInfo &nzbFile : QDir(input).entryInfoList({"*.nzb"}, QDir::Files, QDir::Name))
+                nzbPaths << nzbFile.absoluteFilePath();
+        }
+        else
+            nzbPaths << input;
+    }
+    if (nzbPaths.isEmpty())
+        parser.showHelp(1);
+
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6 %7").arg(
+               "nzb", -40).arg("MB", 9).arg("segments", 10).arg(
+               "ms", 10).arg("MB/s", 9).arg("segments/s", 12).arg("peak RSS MB", 12)
+        << (maxThreads < 0 ? QString() : QString(" %1 %2 %3").arg("parallel ms", 12).arg("threads", 8).arg("speed-up", 9))
+        << "\n" << MB_FLUSH;
+
+    int nbErrors = 0;
+    for (const QString &nzbPath : nzbPaths)
+    {
+        QProcess child;
+        QStringList args = {"--runs", QString::number(nbRuns), "--child", nzbPath};
+        if (maxThreads >= 0)
+            args << "--threads" << QString::number(maxThreads);
+        child.start(QCoreApplication::applicationFilePath(), args);
+        child.waitForFinished(-1);
+        QString     result   = QString::fromLocal8Bit(child.readAllStandardOutput()).trimmed();
+        QStringList measures = result.split(' ');
+        QString     name     = QFileInfo(nzbPath).fileName().left(40);
+
+        if (child.exitCode() != 0 || measures.size() != (maxThreads < 0 ? 3 : 5))
+        {
+            ++nbErrors;
+            out << QString("%1 %2").arg(name, -40).arg(result) << "\n" << MB_FLUSH;
+            continue;
+        }
+
+        double mb         = QFileInfo(nzbPath).size() / (1024. * 1024.);
+        int    nbSegments = measures.at(0).toInt();
+        double secs       = measures.at(1).toLongLong() / 1e9;
+        qint64 rssKB      = measures.at(2).toLongLong();
+        out << QString("%1 %2 %3 %4 %5 %6 %7").arg(
+                   name, -40).arg(
+                   mb, 9, 'f', 2).arg(
+                   nbSegments, 10).arg(
+                   secs * 1000, 10, 'f', 1).arg(
+                   secs > 0 ? mb / secs : 0., 9, 'f', 1).arg(
+                   secs > 0 ? nbSegments / secs : 0., 12, 'f', 0).arg(
+                   rssKB < 0 ? QString("n/a") : QString::number(rssKB / 1024., 'f', 1), 12);
+        if (maxThreads >= 0)
+        {
+            double parallelSecs = measures.at(3).toLongLong() / 1e9;
+            out << QString(" %1 %2 %3").arg(
+                       parallelSecs * 1000, 12, 'f', 1).arg(
+                       measures.at(4), 8).arg(
+                       parallelSecs > 0 ? QString("x%1").arg(secs / parallelSecs, 0, 'f', 2) : QString("n/a"), 9);
+        }
+        out << "\n" << MB_FLUSH;
+    }
+    return nbErrors;
+}
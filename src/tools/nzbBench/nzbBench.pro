@@ -0,0 +1,21 @@
+QT -= gui
+QT += concurrent
+
+TARGET = nzbBench
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        ../../MemoryStats.cpp \
+        ../../NzbParser.cpp \
+        main.cpp
+
+HEADERS += \
+    ../../MemoryStats.h \
+    ../../NzbParser.h \
+    ../../PureStaticClass.h
@@ -0,0 +1,193 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+// nzbGen: generate synthetic nzbs to benchmark (or fuzz) the nzb parsing
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QFile>
+#include <QDir>
+#include <QMap>
+
+namespace
+{
+enum class Malformed {NONE = 0, TRUNCATED, MISSING, DUPLICATE, ZERO_BYTES, BAD_XML};
+
+const QMap<QString, Malformed> sMalformedNames = {
+    {"none",      Malformed::NONE},
+    {"truncated", Malformed::TRUNCATED},  //!< xml cut in the middle of a segment
+    {"missing",   Malformed::MISSING},    //!< less segments than the yEnc subject expects
+    {"duplicate", Malformed::DUPLICATE},  //!< some segments are listed twice
+    {"zerobytes", Malformed::ZERO_BYTES}, //!< some segments have bytes="0"
+    {"badxml",    Malformed::BAD_XML},    //!< unescaped characters in the subjects
+};
+
+struct GenParams
+{
+    int       nbFiles;
+    int       nbSegments;  //!< per file
+    int       msgIdLength; //!< length of the random part of the message-ids
+    bool      yEnc;        //!< subject following yEnc format "[x/N] - "file" yEnc (1/N)"
+    Malformed malformed;
+};
+
+QString randomId(QRandomGenerator &rand, int length)
+{
+    static const char sChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    QString id(length, Qt::Uninitialized);
+    for (int i = 0; i < length; ++i)
+        id[i] = QLatin1Char(sChars[rand.bounded(static_cast<int>(sizeof(sChars) - 1))]);
+    return id;
+}
+
+bool generate(const QString &path, const GenParams &params, QRandomGenerator &rand)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate|QIODevice::Text))
+    {
+        QTextStream(stderr) << "Error creating " << path << ": " << file.errorString() << "\n";
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<!DOCTYPE nzb PUBLIC \"-//newzBin//DTD NZB 1.1//EN\" \"http://www.newzbin.com/DTD/nzb/nzb-1.1.dtd\">\n"
+        << "<nzb xmlns=\"http://www.newzbin.com/DTD/2003/nzb\">\n";
+
+    const qint64 segmentBytes = 716800;
+    for (int f = 1; f <= params.nbFiles; ++f)
+    {
+        QString fileName = QString("%1.part%2.rar").arg(randomId(rand, 16)).arg(f, 3, 10, QChar('0'));
+        QString quote    = params.malformed == Malformed::BAD_XML ? "\"" : "&quot;";
+        QString subject  = params.yEnc ? QString("[%1/%2] - %3%4%3 yEnc (1/%5)").arg(
+                                             f).arg(params.nbFiles).arg(quote).arg(fileName).arg(params.nbSegments)
+                                       : fileName;
+        out << "  <file poster=\"nzbGen &lt;nzbGen@nzbCheck&gt;\" date=\"1600000000\" subject=\"" << subject << "\">\n"
+            << "    <groups>\n      <group>alt.binaries.test</group>\n    </groups>\n"
+            << "    <segments>\n";
+
+        int nbSegments = params.nbSegments;
+        if (params.malformed == Malformed::MISSING && f % 2)
+            nbSegments -= 1 + nbSegments / 10;
+
+        QString previousId;
+        for (int s = 1; s <= nbSegments; ++s)
+        {
+            QString msgId = QString("%1@nzbGen").arg(randomId(rand, params.msgIdLength));
+            qint64  bytes = params.malformed == Malformed::ZERO_BYTES && s % 7 == 0 ? 0 : segmentBytes;
+            if (params.malformed == Malformed::DUPLICATE && s % 5 == 0 && !previousId.isEmpty())
+                msgId = previousId;
+
+            if (params.malformed == Malformed::TRUNCATED && f == (params.nbFiles + 1) / 2 && s == (nbSegments + 1) / 2)
+            {
+                out << "      <segment bytes=\"" << bytes << "\" number=\"" << s << "\">" << msgId.left(msgId.size() / 2);
+                return true; // the file is closed by QFile destructor
+            }
+
+            out << "      <segment bytes=\"" << bytes << "\" number=\"" << s << "\">" << msgId << "</segment>\n";
+            previousId = msgId;
+        }
+        out << "    </segments>\n  </file>\n";
+    }
+    out << "</nzb>\n";
+    return true;
+}
+
+//! standard set of inputs to benchmark the parser or feed a fuzzer
+bool generateCorpus(const QString &dirPath, QRandomGenerator &rand)
+{
+    QDir dir;
+    if (!dir.mkpath(dirPath))
+    {
+        QTextStream(stderr) << "Error creating folder " << dirPath << "\n";
+        return false;
+    }
+
+    const QList<QPair<int, int>> sizes = { {1, 10}, {20, 100}, {100, 1000}, {1000, 1000} };
+    for (const QPair<int, int> &size : sizes)
+    {
+        for (bool yEnc : {true, false})
+        {
+            for (int msgIdLength : {24, 64})
+            {
+                GenParams params = {size.first, size.second, msgIdLength, yEnc, Malformed::NONE};
+                QString path = QString("%1/f%2_s%3_id%4_%5.nzb").arg(dirPath).arg(
+                            size.first).arg(size.second).arg(msgIdLength).arg(yEnc ? "yenc" : "plain");
+                if (!generate(path, params, rand))
+                    return false;
+            }
+        }
+    }
+    for (auto it = sMalformedNames.cbegin(), itEnd = sMalformedNames.cend(); it != itEnd; ++it)
+    {
+        if (it.value() == Malformed::NONE)
+            continue;
+        GenParams params = {20, 100, 32, true, it.value()};
+        if (!generate(QString("%1/malformed_%2.nzb").arg(dirPath).arg(it.key()), params, rand))
+            return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("generate synthetic nzbs to benchmark the nzbCheck parser");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"o", "output"},    "nzb file to generate", "output"},
+        {"corpus",           "generate a standard set of nzbs (sizes, subject styles, malformed variants) in a folder", "corpus"},
+        {{"f", "files"},     "number of files (default 10)", "files", "10"},
+        {{"s", "segments"},  "number of segments per file (default 100)", "segments", "100"},
+        {{"l", "msgid-len"}, "length of the message-ids (default 32)", "msgid-len", "32"},
+        {"no-yenc",          "subjects not following the yEnc format"},
+        {"malformed",        "none, truncated, missing, duplicate, zerobytes or badxml", "malformed", "none"},
+        {"seed",             "seed of the random generator (default 42)", "seed", "42"}
+    });
+    parser.process(app);
+
+    QRandomGenerator rand(parser.value("seed").toUInt());
+    if (parser.isSet("corpus"))
+        return generateCorpus(parser.value("corpus"), rand) ? 0 : 1;
+
+    if (!parser.isSet("output"))
+    {
+        QTextStream(stderr) << "Error: you should provide the output nzb (-o) or a corpus folder (--corpus)\n";
+        return 1;
+    }
+
+    GenParams params;
+    params.nbFiles     = parser.value("files").toInt();
+    params.nbSegments  = parser.value("segments").toInt();
+    params.msgIdLength = parser.value("msgid-len").toInt();
+    params.yEnc        = !parser.isSet("no-yenc");
+    params.malformed   = sMalformedNames.value(parser.value("malformed"), Malformed::NONE);
+    if (params.nbFiles <= 0 || params.nbSegments <= 0 || params.msgIdLength <= 0)
+    {
+        QTextStream(stderr) << "Error: files, segments and msgid-len should be positive integers\n";
+        return 1;
+    }
+
+    return generate(parser.value("output"), params, rand) ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+QT -= gui
+
+TARGET = nzbGen
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        main.cpp
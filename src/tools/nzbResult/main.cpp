@@ -0,0 +1,105 @@
+//========================================================================
+//
+// Copyright (C) 2020 Matthieu Bruel <Matthieu.Bruel@gmail.com>
+//
+// This file is a part of ngPost : https://github.com/mbruel/nzbCheck
+//
+// ngPost is free software; you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; version 3.0 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301,
+// USA.
+//
+//========================================================================
+
+// nzbResult: print a binary result of nzbCheck (--result-format bin)
+// only the header and the index are read, then the records of the files asked (all by default)
+#include "ResultFile.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QStringList>
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+    #define MB_FLUSH flush
+#else
+    #define MB_FLUSH Qt::flush
+#endif
+
+//! "1-3, 7" and the number of segments in the ranges
+static QString toString(const QVector<ResultFile::Range> &ranges, quint32 &nbSegments)
+{
+    QStringList strings;
+    for (const ResultFile::Range &range : ranges)
+    {
+        nbSegments += range.count;
+        strings << (range.count == 1 ? QString::number(range.first)
+                                     : QString("%1-%2").arg(range.first).arg(range.first + range.count - 1));
+    }
+    return strings.join(", ");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("print a binary result of nzbCheck (missing segments per file)");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"f", "file"}, "only print the file at this index (in the order of the nzb)", "index"},
+        {{"s", "summary"}, "only print the counters"}
+    });
+    parser.addPositionalArgument("result", "binary result (nzbcheck -r <result> --result-format bin)", "result");
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QTextStream out(stdout), err(stderr);
+    ResultFile  result(parser.positionalArguments().first());
+    QString     error;
+    if (!result.open(error))
+    {
+        err << error << "\n" << MB_FLUSH;
+        return 1;
+    }
+    out << QString("%1: %2/%3 missing Article(s) in %4 file(s)").arg(result.nzbName()).arg(
+               result.nbMissing()).arg(result.nbArticles()).arg(result.nbFiles());
+    if (result.nbChecked() < result.nbArticles())
+        out << QString(", %1 not checked").arg(result.nbArticles() - result.nbChecked());
+    out << "\n" << MB_FLUSH;
+    if (parser.isSet("summary"))
+        return 0;
+
+    int first = 0, last = result.nbFiles() - 1;
+    if (parser.isSet("file"))
+        first = last = parser.value("file").toInt();
+
+    for (int i = first; i <= last; ++i)
+    {
+        ResultFile::FileResult fileResult;
+        if (!result.file(i, fileResult))
+        {
+            err << QString("Error reading the file #%1").arg(i) << "\n" << MB_FLUSH;
+            return 1;
+        }
+        if (fileResult.missing.isEmpty() && fileResult.unchecked.isEmpty() && !parser.isSet("file"))
+            continue;
+
+        quint32 nbMissing = 0, nbUnchecked = 0;
+        QString missing   = toString(fileResult.missing, nbMissing);
+        QString unchecked = toString(fileResult.unchecked, nbUnchecked);
+        out << QString("#%1 %2: %3 missing (%4 in the nzb, %5 expected): %6").arg(i).arg(fileResult.subject).arg(
+                   nbMissing).arg(fileResult.nbSegments).arg(fileResult.nbExpectedSegments).arg(missing);
+        if (nbUnchecked > 0)
+            out << QString(", %1 not checked: %2").arg(nbUnchecked).arg(unchecked);
+        out << "\n" << MB_FLUSH;
+    }
+    return 0;
+}
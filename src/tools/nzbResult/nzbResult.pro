@@ -0,0 +1,19 @@
+QT -= gui
+
+TARGET = nzbResult
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        ../../ResultFile.cpp \
+        main.cpp
+
+HEADERS += \
+    ../../NzbParser.h \
+    ../../PureStaticClass.h \
+    ../../ResultFile.h